@@ -4,10 +4,18 @@
 #include "concept.h"
 #include "functional.h"
 #include "iterator.h"
+#include "memory.h"
 #include "move.h"
 #include "range.h"
+#include "simd.h"
 #include "type.h"
 
+#include <bit>
+
+#ifndef RADIX_CUTOFF
+#define RADIX_CUTOFF 64U// Below this, radix_sort() is insertion_sort()
+#endif
+
 namespace nuts
 {
 	template <typename... T>
@@ -117,6 +125,10 @@ namespace nuts
 	Itr min_in(Itr st, Itr ed, Compare cmp = Compare {})
 	// Give range by itr: st && ed -> O(n)
 	{
+		if constexpr (simd::Contiguous<Itr> && simd::Ordered_Lane<deref_t<Itr>> &&
+		              (Same<Compare, less<>> || Same<Compare, greater<>>))
+			return st + simd::extreme<Same<Compare, greater<>>>(st, ed - st + 1);
+
 		auto tmp = st;
 		if (st != ed) {
 			auto _end = next(ed);
@@ -131,6 +143,10 @@ namespace nuts
 	Itr max_in(Itr st, Itr ed, Compare cmp = Compare {})
 	// Give range by itr: st && ed -> O(n)
 	{
+		if constexpr (simd::Contiguous<Itr> && simd::Ordered_Lane<deref_t<Itr>> &&
+		              (Same<Compare, less<>> || Same<Compare, greater<>>))
+			return st + simd::extreme<Same<Compare, greater<>>>(st, ed - st + 1);
+
 		auto tmp = st;
 		if (st != ed) {
 			auto _end = next(ed);
@@ -173,6 +189,9 @@ namespace nuts
 	void reverse(Itr st, Itr ed)
 	// Give range by itr: st && ed -> O(n)
 	{
+		if constexpr (simd::Contiguous<Itr>)
+			return simd::reverse(st, ed - st + 1);
+
 		while (st != ed && st != prev(ed)) {
 			itr_swap(st, ed);
 			++st;
@@ -188,9 +207,14 @@ namespace nuts
 	{
 		if (st == ed)
 			return true;
-		auto it = st;
-		for (++it; it != ed; st = it, (void) ++it)
-			if (!cmp(*st, *ed))
+
+		if constexpr (simd::Contiguous<Itr> && simd::Ordered_Lane<deref_t<Itr>> &&
+		              (Same<Compare, less<>> || Same<Compare, greater<>>))
+			return simd::sorted<Same<Compare, greater<>>>(st, ed - st + 1);
+
+		auto it = st, end = next(ed);
+		for (++it; it != end; st = it, (void) ++it)
+			if (cmp(*it, *st))
 				return false;
 		return true;
 	}
@@ -239,6 +263,18 @@ namespace nuts
 	Itr find(Itr st, Itr ed, const auto& val, Fn&& cmp = Fn {})
 	// Give range by itr: st && ed -> O(n)
 	{
+		using T = std::remove_cv_t<deref_t<Itr>>;
+		using V = std::remove_cvref_t<decltype(val)>;
+		if constexpr (simd::Contiguous<Itr> && Same<std::remove_cvref_t<Fn>, equal<>> &&
+		              (Same<V, T> || (std::is_integral_v<T> && std::is_integral_v<V> &&
+		                              !Same<V, bool>)))
+		{
+			// Only if val survives the trip to T, so x == val keeps its meaning
+			const T key = static_cast<T>(val);
+			if (static_cast<V>(key) == val)
+				return st + simd::find(st, ed - st + 1, key);
+		}
+
 		return find_if(st, ed, [&](const auto& x) {
 			return cmp(x, val);
 		});
@@ -286,6 +322,12 @@ namespace nuts
 	template <Forward_Itr Itr>
 	Itr fill_n(Itr st, u64 n, const deref_t<Itr>& val)
 	{
+		if constexpr (simd::Contiguous<Itr> && !std::is_const_v<std::remove_pointer_t<Itr>>)
+		{
+			simd::fill(st, n, val);
+			return st;
+		}
+
 		auto res = st;
 		while (n--) {
 			*st = val;
@@ -549,40 +591,319 @@ namespace nuts
 		shell_sort(box.begin(), box.end(), cmp);
 	}
 
+	namespace detail
+	{
+		// Half-open ranges from here on, lengths are passed along
+		static constexpr i64 STABLE_MIN_RUN = 32,// Short runs are extended by insertion
+		        STABLE_MIN_GALLOP = 7;           // Wins in a row before galloping
+
+		// Number of leading indices i < len with at(i), which holds on a prefix
+		template <class At>
+		i64 gallop(i64 len, At at)
+		{
+			i64 lo = 0, hi = 1;
+			while (hi <= len && at(hi - 1)) {
+				lo = hi;
+				hi = hi * 2 + 1;
+			}
+			if (hi > len) hi = len;
+			while (lo < hi) {
+				const i64 m = lo + (hi - lo) / 2;
+				if (at(m))
+					lo = m + 1;
+				else
+					hi = m;
+			}
+			return lo;
+		}
+
+		// Swap [first, middle) and [middle, last), return where first went
+		template <Forward_Itr Itr>
+		Itr rotate_forward(Itr first, Itr middle, Itr last)
+		{
+			if (first == middle) return last;
+			if (middle == last) return first;
+
+			Itr next = middle;
+			do {
+				itr_swap(first++, next++);
+				if (first == middle) middle = next;
+			} while (next != last);
+
+			Itr res = first;
+			next = middle;
+			while (next != last) {
+				itr_swap(first++, next++);
+				if (first == middle)
+					middle = next;
+				else if (next == last)
+					next = middle;
+			}
+			return res;
+		}
+
+		// Merge by rotations, no memory needed -> O(nlog^2n) in total
+		template <Forward_Itr Itr, class Compare>
+		void merge_without_buffer(Itr first, Itr middle, Itr last,
+		                          i64 len1, i64 len2, Compare& cmp)
+		{
+			if (len1 == 0 || len2 == 0) return;
+			if (len1 + len2 == 2) {
+				if (cmp(*middle, *first)) itr_swap(first, middle);
+				return;
+			}
+
+			Itr cut1 = first, cut2 = middle;
+			i64 len11, len22;
+			if (len1 > len2) {
+				len11 = len1 / 2;
+				cut1 = advance(cut1, len11);
+				len22 = gallop(len2, [&](i64 i) { return cmp(*advance(middle, i), *cut1); });
+				cut2 = advance(cut2, len22);
+			}
+			else {
+				len22 = len2 / 2;
+				cut2 = advance(cut2, len22);
+				len11 = gallop(len1, [&](i64 i) { return !cmp(*cut2, *advance(first, i)); });
+				cut1 = advance(cut1, len11);
+			}
+
+			Itr new_middle = rotate_forward(cut1, middle, cut2);
+			merge_without_buffer(first, cut1, new_middle, len11, len22, cmp);
+			merge_without_buffer(new_middle, cut2, last, len1 - len11, len2 - len22, cmp);
+		}
+
+		template <Forward_Itr Itr, class Compare>
+		void merge_sort_without_buffer(Itr first, i64 size, Compare& cmp)
+		{
+			if (size < 2) return;
+			const i64 half = size / 2;
+			Itr mid = advance(first, half);
+			merge_sort_without_buffer(first, half, cmp);
+			merge_sort_without_buffer(mid, size - half, cmp);
+			merge_without_buffer(first, mid, advance(mid, size - half),
+			                     half, size - half, cmp);
+		}
+
+		// [lo, start) is sorted, insert [start, hi) behind its equals
+		template <class Itr, class Compare>
+		void binary_insertion(Itr a, i64 lo, i64 start, i64 hi, Compare& cmp)
+		{
+			for (i64 i = start; i < hi; ++i) {
+				const i64 pos = lo + gallop(i - lo, [&](i64 k) { return !cmp(a[i], a[lo + k]); });
+				if (pos == i) continue;
+				auto tmp = move(a[i]);
+				for (i64 k = i; k > pos; --k)
+					a[k] = move(a[k - 1]);
+				a[pos] = move(tmp);
+			}
+		}
+
+		// End of the run starting at i, a strictly descending run gets reversed
+		template <class Itr, class Compare>
+		i64 count_run(Itr a, i64 i, i64 n, Compare& cmp)
+		{
+			i64 j = i + 1;
+			if (j == n) return n;
+			if (cmp(a[j], a[i])) {
+				while (j + 1 < n && cmp(a[j + 1], a[j])) ++j;
+				reverse(a + i, a + j);
+			}
+			else
+				while (j + 1 < n && !cmp(a[j + 1], a[j])) ++j;
+			return j + 1;
+		}
+
+		// Powersort: depth of the boundary between two runs in a balanced merge tree
+		inline u32 node_power(i64 n, i64 s1, i64 n1, i64 n2)
+		{
+			// Midpoints of both runs, as fractions of 2n
+			u64 a = 2 * s1 + n1, b = 2 * (s1 + n1) + n2;
+			const u64 two_n = 2 * n;
+			for (u32 k = 1;; ++k) {
+				a <<= 1, b <<= 1;
+				const bool bit_a = a >= two_n, bit_b = b >= two_n;
+				if (bit_a != bit_b) return k;
+				if (bit_a) a -= two_n, b -= two_n;
+			}
+		}
+
+		// Left run moves out to buf, merged forward into place
+		template <class Itr, class T, class Compare>
+		void merge_lo(Itr lo, i64 n1, Itr mid, i64 n2, T* buf, Compare& cmp)
+		{
+			for (i64 i = 0; i < n1; ++i)
+				(void) *new (buf + i) T(move(lo[i]));
+
+			i64 a = 0, b = 0, out = 0, wins_a = 0, wins_b = 0;
+			while (a < n1 && b < n2) {
+				if (cmp(mid[b], buf[a])) {
+					lo[out++] = move(mid[b++]);
+					wins_a = 0;
+					if (++wins_b >= STABLE_MIN_GALLOP) {
+						i64 k = gallop(n2 - b, [&](i64 i) { return cmp(mid[b + i], buf[a]); });
+						while (k--) lo[out++] = move(mid[b++]);
+						wins_b = 0;
+					}
+				}
+				else {
+					lo[out++] = move(buf[a++]);
+					wins_b = 0;
+					if (++wins_a >= STABLE_MIN_GALLOP) {
+						i64 k = gallop(n1 - a, [&](i64 i) { return !cmp(mid[b], buf[a + i]); });
+						while (k--) lo[out++] = move(buf[a++]);
+						wins_a = 0;
+					}
+				}
+			}
+			while (a < n1) lo[out++] = move(buf[a++]);// Rest of the right run is in place
+			destroy_n(buf, n1);
+		}
+
+		// Right run moves out to buf, merged backward into place
+		template <class Itr, class T, class Compare>
+		void merge_hi(Itr lo, i64 n1, Itr mid, i64 n2, T* buf, Compare& cmp)
+		{
+			for (i64 i = 0; i < n2; ++i)
+				(void) *new (buf + i) T(move(mid[i]));
+
+			i64 a = n1, b = n2, out = n1 + n2, wins_a = 0, wins_b = 0;
+			while (a > 0 && b > 0) {
+				if (cmp(buf[b - 1], lo[a - 1])) {
+					lo[--out] = move(lo[--a]);
+					wins_b = 0;
+					if (++wins_a >= STABLE_MIN_GALLOP && b > 0) {
+						i64 k = gallop(a, [&](i64 i) { return cmp(buf[b - 1], lo[a - 1 - i]); });
+						while (k--) lo[--out] = move(lo[--a]);
+						wins_a = 0;
+					}
+				}
+				else {
+					lo[--out] = move(buf[--b]);
+					wins_a = 0;
+					if (++wins_b >= STABLE_MIN_GALLOP && a > 0) {
+						i64 k = gallop(b, [&](i64 i) { return !cmp(buf[b - 1 - i], lo[a - 1]); });
+						while (k--) lo[--out] = move(buf[--b]);
+						wins_b = 0;
+					}
+				}
+			}
+			while (b > 0) lo[--out] = move(buf[--b]);// Rest of the left run is in place
+			destroy_n(buf, n2);
+		}
+
+		// Merge [lo, mid) and [mid, hi) of a, buf may be null
+		template <class Itr, class T, class Compare>
+		void merge_runs(Itr a, i64 lo, i64 mid, i64 hi,
+		                T* buf, i64 buf_cap, Compare& cmp)
+		{
+			// Skip what is already in place at both ends
+			lo += gallop(mid - lo, [&](i64 i) { return !cmp(a[mid], a[lo + i]); });
+			if (lo == mid) return;
+			hi -= gallop(hi - mid, [&](i64 i) { return !cmp(a[hi - 1 - i], a[mid - 1]); });
+
+			const i64 n1 = mid - lo, n2 = hi - mid;
+			if (buf != nullptr && min(n1, n2) <= buf_cap) {
+				if (n1 <= n2)
+					merge_lo(a + lo, n1, a + mid, n2, buf, cmp);
+				else
+					merge_hi(a + lo, n1, a + mid, n2, buf, cmp);
+			}
+			else
+				merge_without_buffer(a + lo, a + mid, a + hi, n1, n2, cmp);
+		}
+	}
+
 	template <Forward_Itr Itr, class Compare = less<>>
-	// Stable && Average case -> O(nlogn)
+	// Stable && No extra memory -> O(nlog^2n)
 	void merge_sort_in_place(Itr first, Itr last,
 	                         Compare cmp = Compare {}, i64 size = 0)
 	{
 		if (size == 0 && first != last)
 			size = distance(first, last);
-		if (size <= 1) return;
-		if (size == 2) {
-			if (cmp(*last, *first))
-				itr_swap(first, last);
-			return;
+		detail::merge_sort_without_buffer(first, size, cmp);
+	}
+
+	template <Forward_Itr Itr, class Compare = less<>>
+	// Stable && Adaptive, presorted -> O(n), otherwise O(nlogn)
+	void stable_sort(Itr st, Itr ed, Compare cmp = Compare {})
+	{
+		if constexpr (!Random_Itr<Itr>)
+			return merge_sort_in_place(st, ed, cmp);
+		else {
+			using T = deref_t<Itr>;
+			using detail::STABLE_MIN_RUN;
+
+			const i64 n = distance(st, ed);
+			if (n < 2) return;
+			if (n <= STABLE_MIN_RUN)
+				return detail::binary_insertion(st, 0, 1, n, cmp);
+
+			// Natural runs, short ones extended, merged by powersort's policy
+			const i64 buf_cap = n / 2;
+			T* buf = try_allocate_raw<T>(buf_cap);
+
+			struct run
+			{
+				i64 start, len;
+				u32 power;// Of the boundary with the run below
+			} stack[128];
+			u32 top = 0;
+
+			const auto merge_top = [&] {
+				run &x = stack[top - 2], &y = stack[top - 1];
+				detail::merge_runs(st, x.start, y.start, y.start + y.len, buf, buf_cap, cmp);
+				x.len += y.len;
+				--top;
+			};
+
+			for (i64 i = 0; i < n;) {
+				i64 e = detail::count_run(st, i, n, cmp);
+				if (e - i < STABLE_MIN_RUN) {
+					const i64 ext = min(n, i + STABLE_MIN_RUN);
+					detail::binary_insertion(st, i, e, ext, cmp);
+					e = ext;
+				}
+
+				u32 p = 0;
+				if (top > 0) {
+					p = detail::node_power(n, stack[top - 1].start, stack[top - 1].len, e - i);
+					while (top > 1 && stack[top - 1].power > p)
+						merge_top();
+				}
+				stack[top++] = {i, e - i, p};
+				i = e;
+			}
+			while (top > 1) merge_top();
+
+			if (buf != nullptr) deallocate_raw(buf);
 		}
-		auto firstHalf = size / 2,
-		     secondHalf = size - firstHalf;
-		auto mid = advance(first, firstHalf);
-		merge_sort_in_place(first, mid, cmp, firstHalf);
-		merge_sort_in_place(mid, last, cmp, secondHalf);
-		insertion_sort(first, last, cmp);
 	}
 
 	template <Container Box, class Compare = less<>>
 	    requires Forward_Itr<typename Box::iterator>
-	// Stable && Average case -> O(nlogn)
-	void merge_sort(Box& box, Compare cmp = Compare {})
+	// Stable && Adaptive, presorted -> O(n), otherwise O(nlogn)
+	void stable_sort(Box& box, Compare cmp = Compare {})
 	{
-		merge_sort(box.begin(), box.end(), cmp);
+		if constexpr (requires { box.sort(cmp); })
+			box.sort(cmp);// Node-based boxes sort stably by relinking
+		else
+			stable_sort(box.begin(), box.end(), cmp);
 	}
 
 	template <Forward_Itr Itr, class Compare = less<>>
-	// Stable && Average case -> O(nlogn)
+	// Stable && Default stable_sort() -> O(nlogn)
 	void merge_sort(Itr first, Itr last, Compare cmp = Compare {})
 	{
-		merge_sort_in_place(first, last, cmp);
+		stable_sort(first, last, cmp);
+	}
+
+	template <Container Box, class Compare = less<>>
+	    requires Forward_Itr<typename Box::iterator>
+	// Stable && Default stable_sort() -> O(nlogn)
+	void merge_sort(Box& box, Compare cmp = Compare {})
+	{
+		stable_sort(box, cmp);
 	}
 
 	template <u64 Width = 8, Bidirect_Itr Itr,
@@ -740,19 +1061,457 @@ namespace nuts
 		intro_sort_with_depth_limit(box.begin(), box.end(), depth_limit, cmp);
 	}
 
+	template <typename K>
+	    requires(std::is_integral_v<K> || std::is_floating_point_v<K>) &&
+	            (!Same<K, bool>)
+	inline constexpr auto radix_order(K x)
+	// Map a key to an unsigned integer of the same order
+	{
+		using U = std::conditional_t<sizeof(K) == 1, u8,
+		          std::conditional_t<sizeof(K) == 2, u16,
+		          std::conditional_t<sizeof(K) == 4, u32, u64>>>;
+		constexpr U SIGN = U(1) << (sizeof(K) * 8 - 1);
+
+		if constexpr (std::is_floating_point_v<K>) {
+			// Negative: flip all bits, reversing their order; positive: set the sign
+			U u = std::bit_cast<U>(x);
+			return (u & SIGN) ? U(~u) : U(u | SIGN);
+		}
+		else if constexpr (std::is_signed_v<K>)
+			return U(U(x) ^ SIGN);
+		else
+			return U(x);
+	}
+
+	template <u32 Bits = 0, Random_Itr Itr,
+	          class KeyFn = identity<deref_t<Itr>>>
+	// Stable && LSD, one pass per digit -> O(n * key bits / Bits)
+	void radix_sort(Itr st, Itr ed, KeyFn key = KeyFn {})
+	{
+		using T = deref_t<Itr>;
+		using U = decltype(radix_order(key(*st)));
+		constexpr u32 KEY_BITS = sizeof(U) * 8;
+		constexpr u32 B = Bits ? Bits : (KEY_BITS <= 16 ? 8 : 11);
+		static_assert(B == 8 || B == 11 || B == 16, "Digit must be 8, 11 or 16 bits!");
+		constexpr u32 PASSES = (KEY_BITS + B - 1) / B;
+		constexpr u64 R = 1ULL << B;
+
+		const u64 n = distance(st, ed);
+		if (n < RADIX_CUTOFF)
+			return insertion_sort(st, ed, [&](const T& a, const T& b) {
+				return radix_order(key(a)) < radix_order(key(b));
+			});
+
+		const auto digit = [](U k, u32 p) -> u64 {
+			return (k >> (p * B)) & (R - 1);
+		};
+
+		// All histograms in a single read
+		u64* count = allocate_raw<u64>(PASSES * R);
+		memset(count, 0, PASSES * R * sizeof(u64));
+		for (u64 i = 0; i < n; ++i) {
+			const U k = radix_order(key(st[i]));
+			for (u32 p = 0; p < PASSES; ++p)
+				++count[p * R + digit(k, p)];
+		}
+
+		// Ping-pong between the range and a buffer, constructed on first use
+		const U first = radix_order(key(st[0]));
+		T* buf = allocate_raw<T>(n);
+		bool in_buf = false, buf_live = false;
+
+		const auto scatter = [&]<bool Construct>(auto src, auto dst, u64* c, u32 p) {
+			for (u64 i = 0; i < n; ++i) {
+				auto& x = src[i];
+				auto& pos = c[digit(radix_order(key(x)), p)];
+				if constexpr (Construct)
+					(void) *new (&dst[pos++]) T(nuts::move(x));
+				else
+					dst[pos++] = nuts::move(x);
+			}
+		};
+
+		for (u32 p = 0; p < PASSES; ++p) {
+			u64* c = count + p * R;
+			if (c[digit(first, p)] == n)// Constant digit, nothing moves
+				continue;
+
+			for (u64 d = 0, sum = 0; d < R; ++d) {
+				const u64 tmp = c[d];
+				c[d] = sum, sum += tmp;
+			}
+
+			if (!in_buf && !buf_live)
+				scatter.template operator()<true>(st, buf, c, p);
+			else if (!in_buf)
+				scatter.template operator()<false>(st, buf, c, p);
+			else
+				scatter.template operator()<false>(buf, st, c, p);
+			buf_live = true, in_buf = !in_buf;
+		}
+
+		if (in_buf)
+			for (u64 i = 0; i < n; ++i)
+				st[i] = nuts::move(buf[i]);
+		if (buf_live) destroy_n(buf, n);
+		deallocate_raw(buf);
+		deallocate_raw(count);
+	}
+
+	template <u32 Bits = 0, Container Box,
+	          class KeyFn = identity<typename Box::value_type>>
+	    requires Random_Itr<typename Box::iterator>
+	// Stable && LSD, one pass per digit -> O(n * key bits / Bits)
+	void radix_sort(Box& box, KeyFn key = KeyFn {})
+	{
+		radix_sort<Bits>(box.begin(), box.end(), key);
+	}
+
+	namespace detail
+	{
+		// pdqsort, Orson Peters. Internally on half-open ranges [begin, end)
+		static constexpr i64 PDQ_INSERTION = 24,// Below this, insertion sort
+		        PDQ_NINTHER = 128,              // Above this, pivot is a ninther
+		        PDQ_PARTIAL_LIMIT = 8,          // Moves before giving up on a presorted run
+		        PDQ_BLOCK = 64;                 // Offsets buffered per side when branchless
+
+		template <class Itr>
+		struct pdq_split
+		{
+			Itr pivot;
+			bool partitioned;// No element was on the wrong side
+		};
+
+		template <class Itr, class Compare>
+		void pdq_insertion(Itr begin, Itr end, Compare& cmp)
+		{
+			if (begin == end) return;
+			for (Itr cur = begin + 1; cur != end; ++cur) {
+				Itr sift = cur, sift_1 = cur - 1;
+				if (cmp(*sift, *sift_1)) {
+					auto tmp = move(*sift);
+					do {
+						*sift-- = move(*sift_1);
+					} while (sift != begin && cmp(tmp, *--sift_1));
+					*sift = move(tmp);
+				}
+			}
+		}
+
+		// *(begin - 1) is no greater than any element, so no bound check
+		template <class Itr, class Compare>
+		void pdq_unguarded_insertion(Itr begin, Itr end, Compare& cmp)
+		{
+			if (begin == end) return;
+			for (Itr cur = begin + 1; cur != end; ++cur) {
+				Itr sift = cur, sift_1 = cur - 1;
+				if (cmp(*sift, *sift_1)) {
+					auto tmp = move(*sift);
+					do {
+						*sift-- = move(*sift_1);
+					} while (cmp(tmp, *--sift_1));
+					*sift = move(tmp);
+				}
+			}
+		}
+
+		// Stop after PDQ_PARTIAL_LIMIT moves, true if the range is now sorted
+		template <class Itr, class Compare>
+		bool pdq_partial_insertion(Itr begin, Itr end, Compare& cmp)
+		{
+			if (begin == end) return true;
+			i64 limit = 0;
+			for (Itr cur = begin + 1; cur != end; ++cur) {
+				Itr sift = cur, sift_1 = cur - 1;
+				if (cmp(*sift, *sift_1)) {
+					auto tmp = move(*sift);
+					do {
+						*sift-- = move(*sift_1);
+					} while (sift != begin && cmp(tmp, *--sift_1));
+					*sift = move(tmp);
+					limit += cur - sift;
+				}
+				if (limit > PDQ_PARTIAL_LIMIT) return false;
+			}
+			return true;
+		}
+
+		template <class Itr, class Compare>
+		inline void pdq_sort2(Itr a, Itr b, Compare& cmp)
+		{
+			if (cmp(*b, *a)) itr_swap(a, b);
+		}
+
+		template <class Itr, class Compare>
+		inline void pdq_sort3(Itr a, Itr b, Itr c, Compare& cmp)
+		{
+			pdq_sort2(a, b, cmp);
+			pdq_sort2(b, c, cmp);
+			pdq_sort2(a, b, cmp);
+		}
+
+		template <class Itr>
+		inline void pdq_swap_offsets(Itr first, Itr last, const u8* offsets_l,
+		                             const u8* offsets_r, i64 num, bool use_swaps)
+		{
+			if (use_swaps) {
+				// Same count on both sides, plain swaps keep them in place
+				for (i64 i = 0; i < num; ++i)
+					itr_swap(first + offsets_l[i], last - offsets_r[i]);
+			}
+			else if (num > 0) {
+				// Otherwise one cyclic permutation, one move per element
+				Itr l = first + offsets_l[0], r = last - offsets_r[0];
+				auto tmp = move(*l);
+				*l = move(*r);
+				for (i64 i = 1; i < num; ++i) {
+					l = first + offsets_l[i];
+					*r = move(*l);
+					r = last - offsets_r[i];
+					*l = move(*r);
+				}
+				*r = move(tmp);
+			}
+		}
+
+		// Pivot is *begin, elements equal to it go right
+		// Wrong-side offsets are collected into blocks first, no branch on cmp()
+		template <class Itr, class Compare>
+		pdq_split<Itr> pdq_partition_right_branchless(Itr begin, Itr end, Compare& cmp)
+		{
+			auto pivot = move(*begin);
+			Itr first = begin, last = end;
+
+			// Median of 3 guarantees an element >= pivot on the left, < pivot on the right
+			while (cmp(*++first, pivot));
+			if (first - 1 == begin)
+				while (first < last && !cmp(*--last, pivot));
+			else
+				while (!cmp(*--last, pivot));
+
+			const bool partitioned = first >= last;
+			if (!partitioned) {
+				itr_swap(first, last);
+				++first;
+
+				alignas(64) u8 offsets_l[PDQ_BLOCK], offsets_r[PDQ_BLOCK];
+				Itr base_l = first, base_r = last;
+				i64 num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+
+				while (first < last) {
+					const i64 unknown = last - first,
+					          left_split = num_l == 0 ? (num_r == 0 ? unknown / 2 : unknown) : 0,
+					          right_split = num_r == 0 ? (unknown - left_split) : 0;
+
+					for (i64 i = 0, e = min(left_split, PDQ_BLOCK); i < e; ++first) {
+						offsets_l[num_l] = (u8) i++;
+						num_l += !cmp(*first, pivot);
+					}
+					for (i64 i = 0, e = min(right_split, PDQ_BLOCK); i < e;) {
+						offsets_r[num_r] = (u8) ++i;
+						num_r += cmp(*--last, pivot);
+					}
+
+					const i64 num = min(num_l, num_r);
+					pdq_swap_offsets(base_l, base_r, offsets_l + start_l,
+					                 offsets_r + start_r, num, num_l == num_r);
+					num_l -= num, num_r -= num;
+					start_l += num, start_r += num;
+
+					if (num_l == 0) start_l = 0, base_l = first;
+					if (num_r == 0) start_r = 0, base_r = last;
+				}
+
+				// At most one side still holds offsets, move them next to the boundary
+				if (num_l) {
+					while (num_l--)
+						itr_swap(base_l + offsets_l[start_l + num_l], --last);
+					first = last;
+				}
+				if (num_r) {
+					while (num_r--)
+						itr_swap(base_r - offsets_r[start_r + num_r], first), ++first;
+					last = first;
+				}
+			}
+
+			Itr pivot_pos = first - 1;
+			*begin = move(*pivot_pos);
+			*pivot_pos = move(pivot);
+			return {pivot_pos, partitioned};
+		}
+
+		template <class Itr, class Compare>
+		pdq_split<Itr> pdq_partition_right(Itr begin, Itr end, Compare& cmp)
+		{
+			auto pivot = move(*begin);
+			Itr first = begin, last = end;
+
+			while (cmp(*++first, pivot));
+			if (first - 1 == begin)
+				while (first < last && !cmp(*--last, pivot));
+			else
+				while (!cmp(*--last, pivot));
+
+			const bool partitioned = first >= last;
+			while (first < last) {
+				itr_swap(first, last);
+				while (cmp(*++first, pivot));
+				while (!cmp(*--last, pivot));
+			}
+
+			Itr pivot_pos = first - 1;
+			*begin = move(*pivot_pos);
+			*pivot_pos = move(pivot);
+			return {pivot_pos, partitioned};
+		}
+
+		// Elements equal to the pivot go left, used when many keys repeat
+		template <class Itr, class Compare>
+		Itr pdq_partition_left(Itr begin, Itr end, Compare& cmp)
+		{
+			auto pivot = move(*begin);
+			Itr first = begin, last = end;
+
+			while (cmp(pivot, *--last));
+			if (last + 1 == end)
+				while (first < last && !cmp(pivot, *++first));
+			else
+				while (!cmp(pivot, *++first));
+
+			while (first < last) {
+				itr_swap(first, last);
+				while (cmp(pivot, *--last));
+				while (!cmp(pivot, *++first));
+			}
+
+			Itr pivot_pos = last;
+			*begin = move(*pivot_pos);
+			*pivot_pos = move(pivot);
+			return pivot_pos;
+		}
+
+		template <bool Branchless, class Itr, class Compare>
+		void pdq_loop(Itr begin, Itr end, Compare& cmp,
+		              i64 bad_allowed, bool leftmost = true)
+		{
+			while (true) {
+				const i64 size = end - begin;
+				if (size < PDQ_INSERTION) {
+					if (leftmost)
+						pdq_insertion(begin, end, cmp);
+					else
+						pdq_unguarded_insertion(begin, end, cmp);
+					return;
+				}
+
+				// Pivot to *begin: median of 3, or Tukey's ninther for large ranges
+				const i64 s2 = size / 2;
+				if (size > PDQ_NINTHER) {
+					pdq_sort3(begin, begin + s2, end - 1, cmp);
+					pdq_sort3(begin + 1, begin + (s2 - 1), end - 2, cmp);
+					pdq_sort3(begin + 2, begin + (s2 + 1), end - 3, cmp);
+					pdq_sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1), cmp);
+					itr_swap(begin, begin + s2);
+				}
+				else
+					pdq_sort3(begin + s2, begin, end - 1, cmp);
+
+				// Pivot equals the element left of this range, which is <= everything here
+				// So put all its equals left, they are done
+				if (!leftmost && !cmp(*(begin - 1), *begin)) {
+					begin = pdq_partition_left(begin, end, cmp) + 1;
+					continue;
+				}
+
+				const auto [pivot_pos, partitioned] =
+				        Branchless ? pdq_partition_right_branchless(begin, end, cmp)
+				                   : pdq_partition_right(begin, end, cmp);
+
+				const i64 l_size = pivot_pos - begin,
+				          r_size = end - (pivot_pos + 1);
+
+				if (l_size < size / 8 || r_size < size / 8) {
+					// Too many bad partitions, O(nlogn) is guaranteed from here
+					if (--bad_allowed == 0)
+						return heap_sort(begin, end - 1, cmp);
+
+					// Break patterns with a few fixed swaps
+					if (l_size >= PDQ_INSERTION) {
+						itr_swap(begin, begin + l_size / 4);
+						itr_swap(pivot_pos - 1, pivot_pos - l_size / 4);
+						if (l_size > PDQ_NINTHER) {
+							itr_swap(begin + 1, begin + (l_size / 4 + 1));
+							itr_swap(begin + 2, begin + (l_size / 4 + 2));
+							itr_swap(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+							itr_swap(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+						}
+					}
+					if (r_size >= PDQ_INSERTION) {
+						itr_swap(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+						itr_swap(end - 1, end - r_size / 4);
+						if (r_size > PDQ_NINTHER) {
+							itr_swap(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+							itr_swap(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+							itr_swap(end - 2, end - (1 + r_size / 4));
+							itr_swap(end - 3, end - (2 + r_size / 4));
+						}
+					}
+				}
+				else if (partitioned &&
+				         pdq_partial_insertion(begin, pivot_pos, cmp) &&
+				         pdq_partial_insertion(pivot_pos + 1, end, cmp))
+					return;// Input looked presorted, and it was
+
+				// Recurse left, loop right
+				pdq_loop<Branchless>(begin, pivot_pos, cmp, bad_allowed, leftmost);
+				begin = pivot_pos + 1;
+				leftmost = false;
+			}
+		}
+	}
+
+	template <Random_Itr Itr, class Compare = less<>>
+	// Unstable && Worst case -> O(nlogn), presorted -> O(n)
+	void pdq_sort(Itr st, Itr ed, Compare cmp = Compare {})
+	{
+		const i64 n = distance(st, ed);
+		if (n < 2) return;
+
+		// Block partition only pays off when cmp() is cheap
+		constexpr bool BRANCHLESS = std::is_arithmetic_v<deref_t<Itr>> &&
+		                            (Same<Compare, less<>> || Same<Compare, greater<>>);
+		detail::pdq_loop<BRANCHLESS>(st, st + n, cmp,
+		                             std::bit_width(static_cast<u64>(n)) - 1);
+	}
+
+	template <Container Box, class Compare = less<>>
+	    requires Random_Itr<typename Box::iterator>
+	// Unstable && Worst case -> O(nlogn), presorted -> O(n)
+	void pdq_sort(Box& box, Compare cmp = Compare {})
+	{
+		pdq_sort(box.begin(), box.end(), cmp);
+	}
+
 	template <Bidirect_Itr Itr, class Compare = less<>>
-	// Default intro_sort() && Average case -> O(nlogn)
+	// Default pdq_sort(), intro_sort() without random access -> O(nlogn)
 	void sort(Itr st, Itr ed, Compare cmp = Compare {})
 	{
-		intro_sort(st, ed, cmp);
+		if constexpr (Random_Itr<Itr>)
+			pdq_sort(st, ed, cmp);
+		else
+			intro_sort(st, ed, cmp);
 	}
 
 	template <Container Box, class Compare = less<>>
 	    requires Bidirect_Itr<typename Box::iterator>
-	// Default intro_sort() && Average case -> O(nlogn)
+	// Default pdq_sort(), intro_sort() without random access -> O(nlogn)
 	void sort(Box& box, Compare cmp = Compare {})
 	{
-		sort(box.begin(), box.end(), cmp);
+		if constexpr (requires { box.sort(cmp); })
+			box.sort(cmp);// Node-based boxes relink instead of moving elements
+		else
+			sort(box.begin(), box.end(), cmp);
 	}
 }
 
@@ -197,18 +197,20 @@ namespace nuts
 
 	basic_string(const char*) -> basic_string<char>;
 
+	template <class T>
+	class basic_string_view;
+
+	// Compares size() characters, a trailing terminator in size() does not count
 	template <class T>
 	bool operator==(const basic_string<T>& a, const basic_string<T>& b)
 	{
-		u64 _n = a.size() < b.size() ? a.size() : b.size();
-		return __memcmpeq(a.data(), b.data(), _n) == 0;
+		return basic_string_view<T>(a) == basic_string_view<T>(b);
 	}
 
 	template <class T>
 	bool operator==(const basic_string<T>& a, const T* b)
 	{
-		u64 _n = a.size() < strlen(b) ? a.size() : strlen(b);
-		return __memcmpeq(a.data(), b, _n) == 0;
+		return basic_string_view<T>(a) == basic_string_view<T>(b);
 	}
 
 	template <class T>
@@ -591,24 +593,74 @@ namespace nuts
 		return *this;
 	}
 
-	template <>
-	struct hash<string>
+	// Non-owning [data, data + size), what string keys hash and compare through
+	template <class T = char>
+	class basic_string_view
 	{
-		u64 operator()(const string& x) const
+	public:
+		using value_type = T;
+
+		constexpr basic_string_view() = default;
+		constexpr basic_string_view(const T* src, u64 n) : ptr(src), len(n) {}
+		basic_string_view(const T* src) : ptr(src), len(length_of(src)) {}
+
+		// A basic_string may carry its '\0' in size(), the view drops only that trailing one
+		basic_string_view(const basic_string<T>& src)
+		    : ptr(src.data()),
+		      len(src.exist() ? src.size() - (src.size() != 0 && src.back() == T {}) : 0) {}
+
+		const T* data() const { return ptr; }
+		u64 size() const { return len; }
+		bool empty() const { return len == 0; }
+		const T& operator[](u64 pos) const { return ptr[pos]; }
+
+		friend bool operator==(const basic_string_view<T>& a,
+		                       const basic_string_view<T>& b)
 		{
-			u64 i = 0;
-			for_each(x, [&i](const auto& c) { i += (u64) c & 0xbf5847; });
+			return a.len == b.len &&
+			       (a.len == 0 || memcmp(a.ptr, b.ptr, a.len * sizeof(T)) == 0);
+		}
 
-			auto hasher = [](u64 x) -> u64 {
-				x = (x ^ (x >> 30)) * u64(0xbf58476d1ce4e5b9);
-				x = (x ^ (x >> 27)) * u64(0x94d049bb133112eb);
-				x = x ^ (x >> 31);
-				return x;
-			};
+	protected:
+		const T* ptr = nullptr;
+		u64 len = 0;
 
-			return hasher(i);
+		static u64 length_of(const T* src)
+		{
+			u64 n = 0;
+			while (src[n] != T {}) ++n;
+			return n;
 		}
 	};
+
+	using string_view = basic_string_view<char>;
+
+	template <class T>
+	struct hash<basic_string_view<T>>
+	{
+		u64 operator()(const basic_string_view<T>& x) const
+		{
+			return hash_bytes(x.data(), x.size() * sizeof(T));
+		}
+	};
+
+	// Same value as the const T* and the view of the same characters,
+	// so string keys can be looked up by either without building a string
+	template <class T>
+	struct hash<basic_string<T>> : hash<basic_string_view<T>>
+	{
+		u64 operator()(const basic_string<T>& x) const
+		{
+			return hash<basic_string_view<T>>::operator()(x);
+		}
+
+		u64 operator()(const T* x) const
+		{
+			return hash<basic_string_view<T>>::operator()(x);
+		}
+
+		using hash<basic_string_view<T>>::operator();
+	};
 }
 
 #endif
@@ -10,11 +10,11 @@
 
 namespace nuts
 {
-	template <typename T>
+	template <typename T, Allocator Alloc = allocator<T>>
 	struct binary_tree_node
 	{
-		using tree_node = binary_tree_node<T>;
-		using node_ptr = unique_ptr<tree_node>;
+		using tree_node = binary_tree_node<T, Alloc>;
+		using node_ptr = unique_ptr<tree_node, alloc_delete_fn<Alloc>>;
 
 		T data;
 		i8 bf = 0;
@@ -35,8 +35,8 @@ namespace nuts
 		~binary_tree_node() noexcept { prev = nullptr; }
 	};
 
-	template <typename T>
-	i8 get_w(const binary_tree_node<T>* st)
+	template <typename T, class A>
+	i8 get_w(const binary_tree_node<T, A>* st)
 	{
 		if (st == nullptr)
 			return -1;
@@ -45,32 +45,36 @@ namespace nuts
 		return max(get_w(st->lc.get()), get_w(st->rc.get())) + 1;
 	}
 
-	template <typename T>
-	i8 get_bf(const binary_tree_node<T>* st)
+	template <typename T, class A>
+	i8 get_bf(const binary_tree_node<T, A>* st)
 	{
 		return get_w(st->lc.get()) - get_w(st->rc.get());
 	}
 
-	template <typename T>
-	i8 get_w(const unique_ptr<binary_tree_node<T>>& st)
+	template <typename T, class A, class Dx>
+	i8 get_w(const unique_ptr<binary_tree_node<T, A>, Dx>& st)
 	{
 		return get_w(st.get());
 	}
 
-	template <typename T>
-	i8 get_bf(const unique_ptr<binary_tree_node<T>>& st)
+	template <typename T, class A, class Dx>
+	i8 get_bf(const unique_ptr<binary_tree_node<T, A>, Dx>& st)
 	{
 		return get_bf(st.get());
 	}
 
-	template <typename T, class Compare = nuts::less<T>>
+	// Nodes are released by a stateless deleter, Alloc must be default constructible
+	template <typename T, class Compare = nuts::less<T>,
+	          Allocator Alloc = allocator<T>>
 	class binary_tree
 	{
 	public:
 		using value_type = T;
-		using tree_node = binary_tree_node<T>;
-		using node_ptr = unique_ptr<tree_node>;
-		using node_raw_ptr = binary_tree_node<T>*;
+		using allocator_type = Alloc;
+		using tree_node = binary_tree_node<T, Alloc>;
+		using node_ptr = typename tree_node::node_ptr;
+		using node_raw_ptr = tree_node*;
+		using node_allocator = rebind_alloc<Alloc, tree_node>;
 
 	private:
 		template <class vistor>
@@ -91,9 +95,9 @@ namespace nuts
 		{
 		public:
 			using value_type = T;
-			using tree_node = binary_tree_node<T>;
-			using node_ptr = unique_ptr<tree_node>;
-			using node_raw_ptr = binary_tree_node<T>*;
+			using tree_node = binary_tree_node<T, Alloc>;
+			using node_ptr = typename tree_node::node_ptr;
+			using node_raw_ptr = tree_node*;
 
 		protected:
 			node_raw_ptr _ptr = nullptr;
@@ -191,12 +195,12 @@ namespace nuts
 			        const { return _ptr != other._ptr; }
 		};
 
-		using itr_type = typename binary_tree<T, Compare>::iterator;
+		using itr_type = typename binary_tree<T, Compare, Alloc>::iterator;
 
 		binary_tree() : root(nullptr), _size(0) {}
 		binary_tree(const std::initializer_list<T>& ilist);
-		binary_tree(const binary_tree<T, Compare>& src);
-		binary_tree(binary_tree<T, Compare>&& src) { move(src); }
+		binary_tree(const binary_tree<T, Compare, Alloc>& src);
+		binary_tree(binary_tree<T, Compare, Alloc>&& src) { move(src); }
 		~binary_tree() { clear(); }
 
 		iterator begin()
@@ -226,10 +230,10 @@ namespace nuts
 		auto lower_bound(const T& _val) const -> iterator;
 		auto upper_bound(const T& _val) const -> iterator;
 
-		binary_tree<T, Compare>& move(binary_tree<T, Compare>& src);
-		binary_tree<T, Compare>& operator=(const binary_tree<T, Compare>& src);
-		binary_tree<T, Compare>&
-		operator=(binary_tree<T, Compare>&& src) { return move(src); }
+		binary_tree<T, Compare, Alloc>& move(binary_tree<T, Compare, Alloc>& src);
+		binary_tree<T, Compare, Alloc>& operator=(const binary_tree<T, Compare, Alloc>& src);
+		binary_tree<T, Compare, Alloc>&
+		operator=(binary_tree<T, Compare, Alloc>&& src) { return move(src); }
 
 		void print_as_tree() const;
 
@@ -256,8 +260,9 @@ namespace nuts
 		static constexpr itr_type npos {};
 	};
 
-	template <typename T, class Compare>
-	binary_tree_node<T>* binary_tree<T, Compare>::min(const node_ptr& st)
+	template <typename T, class Compare, Allocator Alloc>
+	typename binary_tree<T, Compare, Alloc>::node_raw_ptr
+	binary_tree<T, Compare, Alloc>::min(const node_ptr& st)
 	{
 		auto res = get_raw(st);
 		while (res != nullptr && res->lc != nullptr)
@@ -265,8 +270,9 @@ namespace nuts
 		return res;
 	}
 
-	template <typename T, class Compare>
-	binary_tree_node<T>* binary_tree<T, Compare>::max(const node_ptr& st)
+	template <typename T, class Compare, Allocator Alloc>
+	typename binary_tree<T, Compare, Alloc>::node_raw_ptr
+	binary_tree<T, Compare, Alloc>::max(const node_ptr& st)
 	{
 		auto res = get_raw(st);
 		while (res != nullptr && res->rc != nullptr)
@@ -274,15 +280,15 @@ namespace nuts
 		return res;
 	}
 
-	template <typename T, class Compare>
-	binary_tree<T, Compare>::binary_tree(const binary_tree<T, Compare>& src)
+	template <typename T, class Compare, Allocator Alloc>
+	binary_tree<T, Compare, Alloc>::binary_tree(const binary_tree<T, Compare, Alloc>& src)
 	{
 		for_each(src, [&](const auto& x) { insert(x); });
 	}
 
-	template <typename T, class Compare>
-	binary_tree<T, Compare>&
-	binary_tree<T, Compare>::move(binary_tree<T, Compare>& src)
+	template <typename T, class Compare, Allocator Alloc>
+	binary_tree<T, Compare, Alloc>&
+	binary_tree<T, Compare, Alloc>::move(binary_tree<T, Compare, Alloc>& src)
 	{
 		clear();
 		root.move(src.root);
@@ -292,37 +298,37 @@ namespace nuts
 		return *this;
 	}
 
-	template <typename T, class Compare>
-	binary_tree<T, Compare>&
-	binary_tree<T, Compare>::operator=(const binary_tree<T, Compare>& src)
+	template <typename T, class Compare, Allocator Alloc>
+	binary_tree<T, Compare, Alloc>&
+	binary_tree<T, Compare, Alloc>::operator=(const binary_tree<T, Compare, Alloc>& src)
 	{
 		clear();
-		binary_tree<T, Compare> copy = src;
+		binary_tree<T, Compare, Alloc> copy = src;
 		move(copy);
 		return *this;
 	}
 
-	template <typename T, class Compare>
-	i64 get_w(const typename binary_tree<T, Compare>::iterator& st)
+	template <typename T, class Compare, Allocator Alloc>
+	i64 get_w(const typename binary_tree<T, Compare, Alloc>::iterator& st)
 	{
 		return get_w(st.get());
 	}
 
-	template <typename T, class Compare>
-	i64 get_bf(const typename binary_tree<T, Compare>::iterator& st)
+	template <typename T, class Compare, Allocator Alloc>
+	i64 get_bf(const typename binary_tree<T, Compare, Alloc>::iterator& st)
 	{
 		return get_bf(st.get());
 	}
 
-	template <typename T, class Compare>
-	binary_tree<T, Compare>::binary_tree(const std::initializer_list<T>& ilist)
+	template <typename T, class Compare, Allocator Alloc>
+	binary_tree<T, Compare, Alloc>::binary_tree(const std::initializer_list<T>& ilist)
 	{
 		for (const auto& x: ilist) insert(x);
 	}
 
-	template <typename T, class Compare>
+	template <typename T, class Compare, Allocator Alloc>
 	template <class vistor>
-	void binary_tree<T, Compare>::
+	void binary_tree<T, Compare, Alloc>::
 	        pre_order_trav(node_ptr& st, const vistor& func)
 	{
 		if (st != nullptr)
@@ -333,16 +339,16 @@ namespace nuts
 		}
 	}
 
-	template <typename T, class Compare>
+	template <typename T, class Compare, Allocator Alloc>
 	template <class vistor>
-	void binary_tree<T, Compare>::pre_trav(const vistor& func)
+	void binary_tree<T, Compare, Alloc>::pre_trav(const vistor& func)
 	{
 		pre_order_trav(root, func);
 	}
 
-	template <typename T, class Compare>
+	template <typename T, class Compare, Allocator Alloc>
 	template <class vistor>
-	void binary_tree<T, Compare>::
+	void binary_tree<T, Compare, Alloc>::
 	        in_order_trav(node_ptr& st, const vistor& func)
 	{
 		if (st != nullptr)
@@ -353,16 +359,16 @@ namespace nuts
 		}
 	}
 
-	template <typename T, class Compare>
+	template <typename T, class Compare, Allocator Alloc>
 	template <class vistor>
-	void binary_tree<T, Compare>::in_trav(const vistor& func)
+	void binary_tree<T, Compare, Alloc>::in_trav(const vistor& func)
 	{
 		in_order_trav(root, func);
 	}
 
-	template <typename T, class Compare>
+	template <typename T, class Compare, Allocator Alloc>
 	template <class vistor>
-	void binary_tree<T, Compare>::
+	void binary_tree<T, Compare, Alloc>::
 	        post_order_trav(node_ptr& st, const vistor& func)
 	{
 		if (st != nullptr)
@@ -373,16 +379,16 @@ namespace nuts
 		}
 	}
 
-	template <typename T, class Compare>
+	template <typename T, class Compare, Allocator Alloc>
 	template <class vistor>
-	void binary_tree<T, Compare>::post_trav(const vistor& func)
+	void binary_tree<T, Compare, Alloc>::post_trav(const vistor& func)
 	{
 		post_order_trav(root, func);
 	}
 
-	template <typename T, class Compare>
+	template <typename T, class Compare, Allocator Alloc>
 	template <class vistor>
-	void binary_tree<T, Compare>::
+	void binary_tree<T, Compare, Alloc>::
 	        level_trav_helper(node_ptr& st, const vistor& func)
 	{
 		queue<node_raw_ptr> q;
@@ -404,38 +410,38 @@ namespace nuts
 		}
 	}
 
-	template <typename T, class Compare>
+	template <typename T, class Compare, Allocator Alloc>
 	template <class vistor>
-	void binary_tree<T, Compare>::level_trav(const vistor& func)
+	void binary_tree<T, Compare, Alloc>::level_trav(const vistor& func)
 	{
 		level_trav_helper(root, func);
 	}
 
-	template <typename T, class Compare>
-	void binary_tree<T, Compare>::clear()
+	template <typename T, class Compare, Allocator Alloc>
+	void binary_tree<T, Compare, Alloc>::clear()
 	{
-		delete root.get();
-		root = nullptr;
+		node_ptr tmp;
+		tmp.move(root);// Subtrees are released along with tmp
 		_size = 0;
 	}
 
-	template <typename T, class Compare>
-	auto binary_tree<T, Compare>::lower_bound(const T& _val) const
+	template <typename T, class Compare, Allocator Alloc>
+	auto binary_tree<T, Compare, Alloc>::lower_bound(const T& _val) const
 	        -> itr_type
 	{
 		return find_if(begin(), end(), equal<T>());
 	}
 
-	template <typename T, class Compare>
-	auto binary_tree<T, Compare>::upper_bound(const T& _val) const
+	template <typename T, class Compare, Allocator Alloc>
+	auto binary_tree<T, Compare, Alloc>::upper_bound(const T& _val) const
 	        -> itr_type
 	{
 		return find_if(begin(), end(), greater<T>());
 	}
 
-	template <typename T, class Compare>
-	typename binary_tree<T, Compare>::iterator
-	binary_tree<T, Compare>::find(const T& _val) const
+	template <typename T, class Compare, Allocator Alloc>
+	typename binary_tree<T, Compare, Alloc>::iterator
+	binary_tree<T, Compare, Alloc>::find(const T& _val) const
 	{
 		node_raw_ptr st = root.get();
 		while (st != nullptr)
@@ -459,31 +465,32 @@ namespace nuts
 		return npos;
 	}
 
-	template <typename T, class Compare>
-	bool binary_tree<T, Compare>::insert(const T& _val)
+	template <typename T, class Compare, Allocator Alloc>
+	bool binary_tree<T, Compare, Alloc>::insert(const T& _val)
 	{
 		return insert_ret_pos(_val) != npos;
 	}
 
-	template <typename T, class Compare>
-	auto binary_tree<T, Compare>::insert_ret_pos(const T& _val)
+	template <typename T, class Compare, Allocator Alloc>
+	auto binary_tree<T, Compare, Alloc>::insert_ret_pos(const T& _val)
 	        -> itr_type
 	{
 		auto tmp = _val;
 		return insert_ret_pos(nuts::move(tmp));
 	}
 
-	template <typename T, class Compare>
-	bool binary_tree<T, Compare>::insert(T&& _val)
+	template <typename T, class Compare, Allocator Alloc>
+	bool binary_tree<T, Compare, Alloc>::insert(T&& _val)
 	{
 		return insert_ret_pos(_val) != npos;
 	}
 
-	template <typename T, class Compare>
-	auto binary_tree<T, Compare>::insert_ret_pos(T&& _val)
+	template <typename T, class Compare, Allocator Alloc>
+	auto binary_tree<T, Compare, Alloc>::insert_ret_pos(T&& _val)
 	        -> itr_type
 	{
-		node_ptr new_node = new tree_node {nuts::move(_val)};
+		node_allocator a;
+		node_ptr new_node = alloc_new(a, nuts::move(_val));
 
 		if (root == nullptr)
 		{
@@ -522,16 +529,16 @@ namespace nuts
 		}
 	}
 
-	template <typename T, class Compare>
-	bool binary_tree<T, Compare>::erase(const T& _val)
+	template <typename T, class Compare, Allocator Alloc>
+	bool binary_tree<T, Compare, Alloc>::erase(const T& _val)
 	{
 		u64 before = size();
 		erase_ret_pos(_val);
 		return size() < before;
 	}
 
-	template <typename T, class Compare>
-	auto binary_tree<T, Compare>::erase_ret_pos(const T& _val)
+	template <typename T, class Compare, Allocator Alloc>
+	auto binary_tree<T, Compare, Alloc>::erase_ret_pos(const T& _val)
 	        -> itr_type
 	{
 		auto tmp = find(_val);
@@ -628,19 +635,21 @@ namespace nuts
 		return npos;
 	}
 
-	template <typename T, class Compare = nuts::less<T>>
-	using BST = binary_tree<T, Compare>;
+	template <typename T, class Compare = nuts::less<T>,
+	          Allocator Alloc = allocator<T>>
+	using BST = binary_tree<T, Compare, Alloc>;
 
-	template <typename T, class Compare = nuts::less<T>>
-	class AVL : public BST<T, Compare>
+	template <typename T, class Compare = nuts::less<T>,
+	          Allocator Alloc = allocator<T>>
+	class AVL : public BST<T, Compare, Alloc>
 	{
 	public:
-		using tree_node = nuts::binary_tree_node<T>;
-		using node_ptr = nuts::unique_ptr<tree_node>;
-		using node_raw_ptr = binary_tree_node<T>*;
+		using base_type = BST<T, Compare, Alloc>;
+		using tree_node = typename base_type::tree_node;
+		using node_ptr = typename base_type::node_ptr;
+		using node_raw_ptr = typename base_type::node_raw_ptr;
 
-		using base_type = BST<T, Compare>;
-		using self_type = AVL<T, Compare>;
+		using self_type = AVL<T, Compare, Alloc>;
 		using itr_type = typename base_type::iterator;
 
 	private:
@@ -667,32 +676,32 @@ namespace nuts
 		itr_type insert_ret_pos(T&& _val);
 		itr_type erase_ret_pos(const T& _val);
 
-		self_type& operator=(const AVL<T, Compare>& src);
-		self_type& operator=(AVL<T, Compare>&& src) { return base_type::move(src); }
+		self_type& operator=(const AVL<T, Compare, Alloc>& src);
+		self_type& operator=(AVL<T, Compare, Alloc>&& src) { return base_type::move(src); }
 	};
 
-	template <typename T, class Compare>
-	AVL<T, Compare>::AVL(const self_type& src)
+	template <typename T, class Compare, Allocator Alloc>
+	AVL<T, Compare, Alloc>::AVL(const self_type& src)
 	{
 		for_each(src, [&](const T& x) { insert(x); });
 	}
 
-	template <typename T, class Compare>
-	AVL<T, Compare>::AVL(const std::initializer_list<T>& ilist)
+	template <typename T, class Compare, Allocator Alloc>
+	AVL<T, Compare, Alloc>::AVL(const std::initializer_list<T>& ilist)
 	{
 		for (const auto& x: ilist) insert(x);
 	}
 
-	template <typename T, class Compare>
-	AVL<T, Compare>& AVL<T, Compare>::operator=(const self_type& src)
+	template <typename T, class Compare, Allocator Alloc>
+	AVL<T, Compare, Alloc>& AVL<T, Compare, Alloc>::operator=(const self_type& src)
 	{
 		self_type copy(src);
 		base_type::move(copy);
 		return *this;
 	}
 
-	template <typename T, class Compare>
-	void AVL<T, Compare>::update_upon(const node_ptr& ptr)
+	template <typename T, class Compare, Allocator Alloc>
+	void AVL<T, Compare, Alloc>::update_upon(const node_ptr& ptr)
 	{
 		if (ptr == nullptr) return;
 		node_ptr it = ptr.get();
@@ -709,8 +718,8 @@ namespace nuts
 		it = nullptr;
 	}
 
-	template <typename T, class Compare>
-	void AVL<T, Compare>::
+	template <typename T, class Compare, Allocator Alloc>
+	void AVL<T, Compare, Alloc>::
 	        single_rotate_left(node_ptr& ptr)
 	{
 		node_raw_ptr foo = ptr->prev.get();
@@ -747,8 +756,8 @@ namespace nuts
 			this->root = ptr.get();
 	}
 
-	template <typename T, class Compare>
-	void AVL<T, Compare>::
+	template <typename T, class Compare, Allocator Alloc>
+	void AVL<T, Compare, Alloc>::
 	        single_rotate_right(node_ptr& ptr)
 	{
 		node_raw_ptr foo = ptr->prev.get();
@@ -785,24 +794,24 @@ namespace nuts
 			this->root = ptr.get();
 	}
 
-	template <typename T, class Compare>
-	void AVL<T, Compare>::
+	template <typename T, class Compare, Allocator Alloc>
+	void AVL<T, Compare, Alloc>::
 	        double_rotate_left(node_ptr& ptr)
 	{
 		single_rotate_right(ptr->lc);
 		single_rotate_left(ptr);
 	}
 
-	template <typename T, class Compare>
-	void AVL<T, Compare>::
+	template <typename T, class Compare, Allocator Alloc>
+	void AVL<T, Compare, Alloc>::
 	        double_rotate_right(node_ptr& ptr)
 	{
 		single_rotate_left(ptr->rc);
 		single_rotate_right(ptr);
 	}
 
-	template <typename T, class Compare>
-	void AVL<T, Compare>::balance(node_ptr& ptr)
+	template <typename T, class Compare, Allocator Alloc>
+	void AVL<T, Compare, Alloc>::balance(node_ptr& ptr)
 	{
 		if (ptr == nullptr) return;
 		if (get_w(ptr->rc) < get_w(ptr->lc))
@@ -822,28 +831,28 @@ namespace nuts
 		update_upon(ptr);
 	}
 
-	template <typename T, class Compare>
-	bool AVL<T, Compare>::insert(const T& _val)
+	template <typename T, class Compare, Allocator Alloc>
+	bool AVL<T, Compare, Alloc>::insert(const T& _val)
 	{
 		return insert_ret_pos(_val) != this->npos;
 	}
 
-	template <typename T, class Compare>
-	typename BST<T, Compare>::iterator
-	AVL<T, Compare>::insert_ret_pos(const T& _val)
+	template <typename T, class Compare, Allocator Alloc>
+	typename BST<T, Compare, Alloc>::iterator
+	AVL<T, Compare, Alloc>::insert_ret_pos(const T& _val)
 	{
 		auto tmp = _val;
 		return insert_ret_pos(nuts::move(tmp));
 	}
 
-	template <typename T, class Compare>
-	bool AVL<T, Compare>::insert(T&& _val)
+	template <typename T, class Compare, Allocator Alloc>
+	bool AVL<T, Compare, Alloc>::insert(T&& _val)
 	{
 		return insert_ret_pos(nuts::move(_val)) != this->npos;
 	}
 
-	template <typename T, class Compare>
-	void AVL<T, Compare>::adjust(const itr_type& opt)
+	template <typename T, class Compare, Allocator Alloc>
+	void AVL<T, Compare, Alloc>::adjust(const itr_type& opt)
 	{
 		if (opt != this->npos)
 		{
@@ -863,17 +872,17 @@ namespace nuts
 		}
 	}
 
-	template <typename T, class Compare>
-	typename BST<T, Compare>::iterator
-	AVL<T, Compare>::insert_ret_pos(T&& _val)
+	template <typename T, class Compare, Allocator Alloc>
+	typename BST<T, Compare, Alloc>::iterator
+	AVL<T, Compare, Alloc>::insert_ret_pos(T&& _val)
 	{
 		auto opt = base_type::insert_ret_pos(nuts::move(_val));
 		adjust(opt);
 		return opt;
 	}
 
-	template <typename T, class Compare>
-	bool AVL<T, Compare>::erase(const T& _val)
+	template <typename T, class Compare, Allocator Alloc>
+	bool AVL<T, Compare, Alloc>::erase(const T& _val)
 	{
 		u64 before = this->size();
 		erase_ret_pos(_val);
@@ -881,17 +890,17 @@ namespace nuts
 		return this->size() < before;
 	}
 
-	template <typename T, class Compare>
-	typename BST<T, Compare>::iterator
-	AVL<T, Compare>::erase_ret_pos(const T& _val)
+	template <typename T, class Compare, Allocator Alloc>
+	typename BST<T, Compare, Alloc>::iterator
+	AVL<T, Compare, Alloc>::erase_ret_pos(const T& _val)
 	{
 		auto opt = base_type::erase_ret_pos(_val);
 		adjust(opt);
 		return opt;
 	}
 
-	template <typename T, class Compare>
-	void binary_tree<T, Compare>::
+	template <typename T, class Compare, Allocator Alloc>
+	void binary_tree<T, Compare, Alloc>::
 	        printBT(const std::string& prefix,
 	                const node_ptr& st, bool isLeft) const
 	{
@@ -910,8 +919,8 @@ namespace nuts
 		}
 	}
 
-	template <typename T, class Compare>
-	void binary_tree<T, Compare>::printBT(const iterator& st) const
+	template <typename T, class Compare, Allocator Alloc>
+	void binary_tree<T, Compare, Alloc>::printBT(const iterator& st) const
 	{
 		if (st != npos)
 		{
@@ -924,8 +933,8 @@ namespace nuts
 			printf("\n└── #\n");
 	}
 
-	template <typename T, class Compare>
-	void binary_tree<T, Compare>::print_as_tree() const
+	template <typename T, class Compare, Allocator Alloc>
+	void binary_tree<T, Compare, Alloc>::print_as_tree() const
 	{
 		printf("binary_tree @%#llx:", (u64) root.get());
 		if (root != nullptr)
@@ -4,12 +4,16 @@
 #include <iostream>
 
 #include "algorithm.h"
+#include "bucket_index.h"
 #include "concept.h"
 #include "functional.h"
+#include "hash_bytes.h"
+#include "hash_stats.h"
 #include "iterator.h"
 #include "memory.h"
 #include "move.h"
 #include "option.h"
+#include "parallel.h"
 #include "range.h"
 #include "type.h"
 #include "utility.h"
@@ -19,10 +23,13 @@
 #include "basic_string.h"
 #include "deque.h"
 #include "list.h"
+#include "intrusive_list.h"
+#include "unrolled_list.h"
 #include "matrix.h"
 #include "queue.h"
 #include "stack.h"
 #include "vector.h"
+#include "small_vector.h"
 
 #include "binary_tree.h"
 #include "map.h"
@@ -30,6 +37,10 @@
 
 #include "unordered_map.h"
 #include "unordered_set.h"
+#include "flat_hash_map.h"
+#include "flat_hash_set.h"
+#include "dense_hash_map.h"
+#include "concurrent_hash_map.h"
 
 #include "timer.h"
 
@@ -0,0 +1,192 @@
+#ifndef _NUTS_BUCKET_INDEX_
+#define _NUTS_BUCKET_INDEX_
+
+/** @file bucket_index
+     *  Policies that map a full hash to a bucket of a chained hash table
+     *  prime_fastmod: PRIME_LIST sizes, remainder by a precomputed magic multiplier
+     *  prime_mod: PRIME_LIST sizes, plain runtime division
+     *  pow2_fib: power-of-two sizes, fibonacci multiply then keep the top bits
+     */
+
+#include "concept.h"
+#include "type.h"
+
+namespace nuts
+{
+	// Capacity of the bucket
+	static constexpr u64 PRIME_LIST[] = {
+	        /* 0     */ 5ULL,
+	        /* 1     */ 11ULL,
+	        /* 2     */ 23ULL,
+	        /* 3     */ 47ULL,
+	        /* 4     */ 97ULL,
+	        /* 5     */ 199ULL,
+	        /* 6     */ 409ULL,
+	        /* 7     */ 823ULL,
+	        /* 8     */ 1741ULL,
+	        /* 9     */ 3469ULL,
+	        /* 10    */ 6949ULL,
+	        /* 11    */ 14033ULL,
+	        /* 12    */ 28411ULL,
+	        /* 13    */ 57557ULL,
+	        /* 14    */ 116731ULL,
+	        /* 15    */ 236897ULL,
+	        /* 16    */ 480881ULL,
+	        /* 17    */ 976369ULL,
+	        /* 18    */ 1982627ULL,
+	        /* 19    */ 4026031ULL,
+	        /* 20    */ 8175383ULL,
+	        /* 21    */ 16601593ULL,
+	        /* 22    */ 33712729ULL,
+	        /* 23    */ 68460391ULL,
+	        /* 24    */ 139022417ULL,
+	        /* 25    */ 282312799ULL,
+	        /* 26    */ 573292817ULL,
+	        /* 27    */ 1164186217ULL,
+	        /* 28    */ 2364114217ULL,
+	        /* 29    */ 4294967291ULL,
+	        /* 30    */ 8589934583ULL,
+	        /* 31    */ 17179869143ULL,
+	        /* 32    */ 34359738337ULL,
+	        /* 33    */ 68719476731ULL,
+	        /* 34    */ 137438953447ULL,
+	        /* 35    */ 274877906899ULL,
+	        /* 36    */ 549755813881ULL,
+	        /* 37    */ 1099511627689ULL,
+	        /* 38    */ 2199023255531ULL,
+	        /* 39    */ 4398046511093ULL,
+	        /* 40    */ 8796093022151ULL,
+	        /* 41    */ 17592186044399ULL,
+	        /* 42    */ 35184372088777ULL,
+	        /* 43    */ 70368744177643ULL,
+	        /* 44    */ 140737488355213ULL,
+	        /* 45    */ 281474976710597ULL,
+	        /* 46    */ 562949953421231ULL,
+	        /* 47    */ 1125899906842597ULL,
+	        /* 48    */ 2251799813685119ULL,
+	        /* 49    */ 4503599627370449ULL,
+	        /* 50    */ 9007199254740881ULL,
+	        /* 51    */ 18014398509481951ULL,
+	        /* 52    */ 36028797018963913ULL,
+	        /* 53    */ 72057594037927931ULL,
+	        /* 54    */ 144115188075855859ULL,
+	        /* 55    */ 288230376151711717ULL,
+	        /* 56    */ 576460752303423433ULL,
+	        /* 57    */ 1152921504606846883ULL,
+	        /* 58    */ 2305843009213693951ULL,
+	        /* 59    */ 4611686018427387847ULL,
+	        /* 60    */ 9223372036854775783ULL,
+	        /* 61    */ 18446744073709551557ULL,
+	};
+
+	static constexpr u8 PRIME_LAST = sizeof(PRIME_LIST) / sizeof(u64) - 1;
+
+	// A bucket indexer is a small value: current size, hash -> bucket, and resizing
+	template <typename I>
+	concept BucketIndexer = requires(I idx, const I cidx, u64 h, u64 n)
+	{
+		{ cidx.size() } -> Same<u64>;
+		{ cidx(h) } -> Same<u64>;
+		{ idx.grow() } -> Same<bool>;// Step to the next size, false at the last one
+		idx.fit(n);                  // Smallest size not below n
+		idx.reset();                 // Back to the first size
+	};
+
+	// Walks PRIME_LIST, shared by both prime policies
+	struct prime_level
+	{
+		u8 level = 0;
+
+		inline constexpr u64 size() const { return PRIME_LIST[level]; }
+
+		inline constexpr bool grow()
+		{
+			if (level == PRIME_LAST) return false;
+			++level;
+			return true;
+		}
+
+		inline constexpr void fit(u64 n)
+		{
+			while (size() < n && level != PRIME_LAST) ++level;
+		}
+
+		inline constexpr void reset() { level = 0; }
+	};
+
+	struct prime_mod : prime_level
+	{
+		inline constexpr u64 operator()(u64 h) const { return h % size(); }
+	};
+
+#ifdef __SIZEOF_INT128__
+	using u128 = unsigned __int128;
+
+	// Lemire's fastmod: M = ceil(2^128 / d), then h % d = (M * h mod 2^128) * d >> 128
+	// Exact for every 64-bit h and d, see "Faster Remainder by Direct Computation"
+	struct prime_magic_table
+	{
+		u128 magic[PRIME_LAST + 1];
+
+		constexpr prime_magic_table() : magic()
+		{
+			for (u8 i = 0; i <= PRIME_LAST; ++i)
+				magic[i] = ~static_cast<u128>(0) / PRIME_LIST[i] + 1;
+		}
+	};
+
+	static constexpr prime_magic_table PRIME_MAGIC {};
+
+	struct prime_fastmod : prime_level
+	{
+		inline constexpr u64 operator()(u64 h) const
+		{
+			const u128 low = PRIME_MAGIC.magic[level] * h;
+			const u64 d = size();
+			const u128 bottom = (static_cast<u128>(static_cast<u64>(low)) * d) >> 64;
+			const u128 top = static_cast<u128>(static_cast<u64>(low >> 64)) * d;
+			return static_cast<u64>((bottom + top) >> 64);
+		}
+	};
+#else
+	// No 128-bit multiply, fall back to the divide
+	using prime_fastmod = prime_mod;
+#endif
+
+	// 2^shift buckets, the multiply spreads low-entropy hashes (e.g. hash<i32>) over the top bits
+	struct pow2_fib
+	{
+		static constexpr u8 MIN_SHIFT = 3;
+		static constexpr u8 MAX_SHIFT = 63;
+
+		u8 shift = MIN_SHIFT;
+
+		inline constexpr u64 size() const { return 1ULL << shift; }
+
+		inline constexpr u64 operator()(u64 h) const
+		{
+			return (h * 11400714819323198485ULL) >> (64 - shift);
+		}
+
+		inline constexpr bool grow()
+		{
+			if (shift == MAX_SHIFT) return false;
+			++shift;
+			return true;
+		}
+
+		inline constexpr void fit(u64 n)
+		{
+			while (size() < n && shift != MAX_SHIFT) ++shift;
+		}
+
+		inline constexpr void reset() { shift = MIN_SHIFT; }
+	};
+
+	static_assert(BucketIndexer<prime_mod>);
+	static_assert(BucketIndexer<prime_fastmod>);
+	static_assert(BucketIndexer<pow2_fib>);
+	static_assert(prime_fastmod {}.operator()(~0ULL) == ~0ULL % PRIME_LIST[0]);
+}
+
+#endif
@@ -0,0 +1,316 @@
+#ifndef _NUTS_CONCURRENT_HASH_MAP_
+#define _NUTS_CONCURRENT_HASH_MAP_
+
+/** @file concurrent_hash_map
+     *  Shards power-of-two unordered_maps, each behind its own reader-writer lock
+     *  The shard is picked from the high bits of the mixed hash, so shard and bucket stay independent
+     *  Values never leave a shard by reference: find copies, upsert/visit run under the lock
+     */
+
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+#include "type.h"
+#include "unordered_map.h"
+
+namespace nuts
+{
+	inline void cpu_relax() noexcept
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+	// Spin with pause, then give the core away, we may be oversubscribed
+	template <class Fn>
+	inline void spin_until(Fn&& ready) noexcept
+	{
+		for (u32 n = 0; !ready(); ++n)
+		{
+			if (n < 64)
+				cpu_relax();
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	// Reader-writer spin lock, a waiting writer holds back new readers
+	// State: bit 0 writer, bit 1 writer waiting, readers count from bit 2
+	class rw_spin_lock
+	{
+	public:
+		rw_spin_lock() = default;
+		rw_spin_lock(const rw_spin_lock&) = delete;
+		rw_spin_lock& operator=(const rw_spin_lock&) = delete;
+
+		void lock() noexcept
+		{
+			for (;;)
+			{
+				u32 s = state.load(std::memory_order_relaxed);
+				if ((s & ~WAIT) == 0 &&
+				    state.compare_exchange_weak(s, WRITER, std::memory_order_acquire,
+				                                std::memory_order_relaxed))
+					return;
+				if (!(s & WAIT))
+					state.fetch_or(WAIT, std::memory_order_relaxed);
+				spin_until([&] {
+					return (state.load(std::memory_order_relaxed) & ~WAIT) == 0;
+				});
+			}
+		}
+
+		void unlock() noexcept { state.fetch_and(~WRITER, std::memory_order_release); }
+
+		void lock_shared() noexcept
+		{
+			for (;;)
+			{
+				if (!(state.fetch_add(READER, std::memory_order_acquire) & (WRITER | WAIT)))
+					return;
+				state.fetch_sub(READER, std::memory_order_relaxed);
+				spin_until([&] {
+					return !(state.load(std::memory_order_relaxed) & (WRITER | WAIT));
+				});
+			}
+		}
+
+		void unlock_shared() noexcept { state.fetch_sub(READER, std::memory_order_release); }
+
+	protected:
+		static constexpr u32 WRITER = 1, WAIT = 2, READER = 4;
+		std::atomic<u32> state {0};
+	};
+
+	template <typename L>
+	concept Shared_Lockable = requires(L& l)
+	{
+		l.lock();
+		l.unlock();
+		l.lock_shared();
+		l.unlock_shared();
+	};
+
+	template <typename K, typename V,
+	          typename Hasher = nuts::hash<K>,
+	          u64 Shards = 64,
+	          Shared_Lockable Lock = rw_spin_lock>
+	class concurrent_hash_map
+	{
+		static_assert(Shards != 0 && (Shards & (Shards - 1)) == 0,
+		              "Shards must be a power of two");
+
+	public:
+		using value_type = pair<K, V>;
+		using map_type = unordered_map<K, V, Hasher>;
+		using self_type = concurrent_hash_map<K, V, Hasher, Shards, Lock>;
+
+		concurrent_hash_map() = default;
+		concurrent_hash_map(const self_type&) = delete;
+		self_type& operator=(const self_type&) = delete;
+		~concurrent_hash_map() = default;
+
+		static constexpr u64 shard_count() { return Shards; }
+
+		// Only exact when no writer runs at the same time
+		u64 size() const;
+		void clear();
+
+		// Every shard summed, each read under its shared lock
+		hash_stats stats() const;
+
+		// Copies the value into out, true if found
+		template <Lookup_Key<K, Hasher> Q = K>
+		bool find(const Q& _k, V& out) const;
+
+		template <Lookup_Key<K, Hasher> Q = K>
+		bool contains(const Q& _k) const;
+
+		// fn(const V&) under the shared lock, true if found
+		template <Lookup_Key<K, Hasher> Q, class Fn>
+		bool visit(const Q& _k, Fn&& fn) const;
+
+		// Inserts only if absent, true if inserted
+		template <typename Q, typename... Args>
+		    requires Lookup_Key<Q, K, Hasher>
+		bool try_emplace(Q&& _k, Args&&... args);
+
+		bool insert(const K& _k, const V& _val) { return try_emplace(_k, _val); }
+
+		// True if inserted, false if an existing value was overwritten
+		template <typename Q, typename M>
+		    requires Lookup_Key<Q, K, Hasher>
+		bool insert_or_assign(Q&& _k, M&& _val);
+
+		// fn(V&) under the exclusive lock, on the existing value or a new V(); true if inserted
+		template <typename Q, class Fn>
+		    requires Lookup_Key<Q, K, Hasher>
+		bool upsert(Q&& _k, Fn&& fn);
+
+		template <Lookup_Key<K, Hasher> Q = K>
+		bool erase(const Q& _k);
+
+		// fn(map_type&) on every shard in turn, each under its exclusive lock
+		template <class Fn>
+		void for_each_shard(Fn&& fn);
+
+		// fn(const map_type&) on every shard in turn, each under its shared lock
+		template <class Fn>
+		void for_each_shard(Fn&& fn) const;
+
+	protected:
+		struct alignas(64) shard
+		{
+			mutable Lock lock;
+			map_type map;
+		};
+
+		shard table[Shards];
+
+		static constexpr u64 SHIFT = 64 - std::countr_zero(Shards);
+		static constexpr Hasher hash_fn {};
+
+		// High bits after a fibonacci multiply, weak hashers still spread
+		template <typename Q>
+		shard& shard_of(const Q& _k) const
+		{
+			if constexpr (Shards == 1)
+				return const_cast<shard&>(table[0]);
+			else
+			{
+				u64 h = hash_fn(_k) * 11400714819323198485ULL;
+				return const_cast<shard&>(table[h >> SHIFT]);
+			}
+		}
+	};
+
+	template <class K, class V, class Hasher, u64 Shards, Shared_Lockable Lock>
+	u64 concurrent_hash_map<K, V, Hasher, Shards, Lock>::size() const
+	{
+		u64 res = 0;
+		for_each_shard([&](const map_type& m) { res += m.size(); });
+		return res;
+	}
+
+	template <class K, class V, class Hasher, u64 Shards, Shared_Lockable Lock>
+	hash_stats concurrent_hash_map<K, V, Hasher, Shards, Lock>::stats() const
+	{
+		hash_stats res;
+		for_each_shard([&](const map_type& m) { res += m.stats(); });
+		res.bytes += sizeof(*this) - Shards * sizeof(map_type);
+		return res;
+	}
+
+	template <class K, class V, class Hasher, u64 Shards, Shared_Lockable Lock>
+	void concurrent_hash_map<K, V, Hasher, Shards, Lock>::clear()
+	{
+		for_each_shard([](map_type& m) { m.clear(); });
+	}
+
+	template <class K, class V, class Hasher, u64 Shards, Shared_Lockable Lock>
+	template <Lookup_Key<K, Hasher> Q>
+	bool concurrent_hash_map<K, V, Hasher, Shards, Lock>::
+	        find(const Q& _k, V& out) const
+	{
+		return visit(_k, [&](const V& v) { out = v; });
+	}
+
+	template <class K, class V, class Hasher, u64 Shards, Shared_Lockable Lock>
+	template <Lookup_Key<K, Hasher> Q>
+	bool concurrent_hash_map<K, V, Hasher, Shards, Lock>::
+	        contains(const Q& _k) const
+	{
+		shard& s = shard_of(_k);
+		std::shared_lock lk {s.lock};
+		return s.map.contains(_k);
+	}
+
+	template <class K, class V, class Hasher, u64 Shards, Shared_Lockable Lock>
+	template <Lookup_Key<K, Hasher> Q, class Fn>
+	bool concurrent_hash_map<K, V, Hasher, Shards, Lock>::
+	        visit(const Q& _k, Fn&& fn) const
+	{
+		shard& s = shard_of(_k);
+		std::shared_lock lk {s.lock};
+		auto it = s.map.find(_k);
+		if (it == map_type::npos) return false;
+		fn(static_cast<const V&>((*it).second));
+		return true;
+	}
+
+	template <class K, class V, class Hasher, u64 Shards, Shared_Lockable Lock>
+	template <typename Q, typename... Args>
+	    requires Lookup_Key<Q, K, Hasher>
+	bool concurrent_hash_map<K, V, Hasher, Shards, Lock>::
+	        try_emplace(Q&& _k, Args&&... args)
+	{
+		shard& s = shard_of(_k);
+		std::lock_guard lk {s.lock};
+		return s.map.try_emplace(static_cast<Q&&>(_k),
+		                         static_cast<Args&&>(args)...).second;
+	}
+
+	template <class K, class V, class Hasher, u64 Shards, Shared_Lockable Lock>
+	template <typename Q, typename M>
+	    requires Lookup_Key<Q, K, Hasher>
+	bool concurrent_hash_map<K, V, Hasher, Shards, Lock>::
+	        insert_or_assign(Q&& _k, M&& _val)
+	{
+		shard& s = shard_of(_k);
+		std::lock_guard lk {s.lock};
+		return s.map.insert_or_assign(static_cast<Q&&>(_k),
+		                              static_cast<M&&>(_val)).second;
+	}
+
+	template <class K, class V, class Hasher, u64 Shards, Shared_Lockable Lock>
+	template <typename Q, class Fn>
+	    requires Lookup_Key<Q, K, Hasher>
+	bool concurrent_hash_map<K, V, Hasher, Shards, Lock>::
+	        upsert(Q&& _k, Fn&& fn)
+	{
+		shard& s = shard_of(_k);
+		std::lock_guard lk {s.lock};
+		auto res = s.map.try_emplace(static_cast<Q&&>(_k));
+		fn((*res.first).second);
+		return res.second;
+	}
+
+	template <class K, class V, class Hasher, u64 Shards, Shared_Lockable Lock>
+	template <Lookup_Key<K, Hasher> Q>
+	bool concurrent_hash_map<K, V, Hasher, Shards, Lock>::erase(const Q& _k)
+	{
+		shard& s = shard_of(_k);
+		std::lock_guard lk {s.lock};
+		return s.map.erase(_k);
+	}
+
+	template <class K, class V, class Hasher, u64 Shards, Shared_Lockable Lock>
+	template <class Fn>
+	void concurrent_hash_map<K, V, Hasher, Shards, Lock>::for_each_shard(Fn&& fn)
+	{
+		for (auto& s: table)
+		{
+			std::lock_guard lk {s.lock};
+			fn(s.map);
+		}
+	}
+
+	template <class K, class V, class Hasher, u64 Shards, Shared_Lockable Lock>
+	template <class Fn>
+	void concurrent_hash_map<K, V, Hasher, Shards, Lock>::for_each_shard(Fn&& fn) const
+	{
+		for (const auto& s: table)
+		{
+			std::shared_lock lk {s.lock};
+			fn(static_cast<const map_type&>(s.map));
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,491 @@
+#ifndef _NUTS_DENSE_HASH_MAP_
+#define _NUTS_DENSE_HASH_MAP_
+
+/** @file dense_hash_map
+     *  Entries are packed back to back in one vector<pair<K, V>>, begin() is its front
+     *  A separate power-of-two index table of u64 slots maps a hash to an entry by linear probing
+     *  Slot: high 32 bits are the hash tag (also the home slot), low 32 bits entry position + 1, 0 is empty
+     *  Erase moves the last entry into the hole and shifts the probe run back, no tombstones
+     */
+
+#include <cassert>
+#include <cstring>
+
+#include "functional.h"
+#include "hash_stats.h"
+#include "iterator.h"
+#include "move.h"
+#include "type.h"
+#include "utility.h"
+#include "vector.h"
+
+namespace nuts
+{
+	template <typename K, typename V,
+	          typename Hasher = nuts::hash<K>>
+	class dense_hash_map
+	{
+	public:
+		using value_type = pair<K, V>;
+		using k_type = K;
+		using v_type = V;
+		using self_type = dense_hash_map<K, V, Hasher>;
+		using entry_array = vector<value_type>;
+		using index_array = vector<u64>;
+
+		// A pointer into the entry array, stepping past the last entry gives npos
+		class iterator
+		    : public forward_iterator
+		{
+		public:
+			using value_type = pair<K, V>;
+
+		protected:
+			value_type* cur = nullptr;
+			value_type* last = nullptr;
+
+		public:
+			iterator() = default;
+			iterator(value_type* c, value_type* l) : cur(c), last(l) {}
+			iterator(const iterator& src) = default;
+			~iterator() = default;
+
+			iterator& operator=(const iterator& src) = default;
+
+			value_type* get() const { return cur; }
+			value_type& operator*() const { return *cur; }
+			value_type* operator->() const { return cur; }
+
+			iterator& operator++()
+			{
+				if (cur != nullptr)
+					cur = (cur == last) ? nullptr : cur + 1;
+				return *this;
+			}
+
+			iterator operator++(int)
+			{
+				iterator res = *this;
+				++(*this);
+				return res;
+			}
+
+			iterator operator+(u64 bias)
+			        const { return nuts::advance(*this, bias); }
+
+			void operator+=(i64 bias)
+			{
+				while (bias--) ++(*this);
+			}
+
+			inline bool operator==(const iterator& x) const { return cur == x.cur; }
+			inline bool operator!=(const iterator& x) const { return cur != x.cur; }
+		};
+
+		iterator begin() const { return empty() ? npos : make_itr(0); }
+		iterator end() const { return empty() ? npos : make_itr(size() - 1); }
+
+		dense_hash_map() = default;
+		dense_hash_map(const self_type& src) = default;
+		dense_hash_map(self_type&& src) { move(src); }
+		dense_hash_map(const std::initializer_list<value_type>& ilist);
+		~dense_hash_map() = default;
+
+		value_type& front() { return *begin(); }
+		value_type& back() { return *end(); }
+		const value_type& front() const { return *begin(); }
+		const value_type& back() const { return *end(); }
+
+		inline u64 size() const { return entries.size(); }
+		inline bool empty() const { return entries.empty(); }
+		inline u64 capacity() const { return index.size(); }
+
+		// Entries as one contiguous range of size()
+		inline value_type* data() const { return entries.data(); }
+
+		self_type& move(self_type& src);
+
+		template <Lookup_Key<K, Hasher> Q = K>
+		iterator find(const Q& _k) const;
+
+		template <Lookup_Key<K, Hasher> Q = K>
+		bool contains(const Q& _k) const;
+
+		// Batched lookups of keys[0, n): hash and prefetch every home slot,
+		// then prefetch the entries they point to, then resolve
+		template <Lookup_Key<K, Hasher> Q = K>
+		void find_many(const Q* keys, u64 n, iterator* out) const;
+
+		// Returns how many of keys[0, n) are present
+		template <Lookup_Key<K, Hasher> Q = K>
+		u64 contains_many(const Q* keys, u64 n, bool* out) const;
+
+		V& at(const K& _k);
+		const V& at(const K& _k) const;
+
+		V& operator[](const K& _k) { return try_emplace(_k).first->second; }
+		V& operator[](K&& _k) { return try_emplace(nuts::move(_k)).first->second; }
+		const V& operator[](const K& _k) const { return at(_k); }
+
+		// V is built from args only if _k is absent; true if inserted
+		template <typename Q, typename... Args>
+		    requires Lookup_Key<Q, K, Hasher>
+		pair<iterator, bool> try_emplace(Q&& _k, Args&&... args);
+
+		template <typename Q, typename M>
+		    requires Lookup_Key<Q, K, Hasher>
+		pair<iterator, bool> insert_or_assign(Q&& _k, M&& _val);
+
+		void insert(const K& _k, const V& _val) { insert_or_assign(_k, _val); }
+		void insert(const pair<K, V>& _p) { insert_or_assign(_p.first, _p.second); }
+
+		// The last entry takes the place of the erased one
+		template <Lookup_Key<K, Hasher> Q = K>
+		bool erase(const Q& _k);
+
+		void reserve(u64 n);
+		void rehash(u64 new_cap);
+		void clear();
+
+		self_type& operator=(const self_type& src) = default;
+		self_type& operator=(self_type&& src) { return move(src); }
+
+		// Histogram of index slots probed to reach each entry
+		hash_stats stats() const;
+
+		void print() const;
+
+	protected:
+		static constexpr u64 POS_MASK = 0xffffffffULL;
+		static constexpr u64 BATCH = 16;
+
+		template <typename Q>
+		static inline u64 hash_of(const Q& _k)
+		{
+			u64 h = hash_fn(_k) * 0x9e3779b97f4a7c15ULL;
+			return h ^ (h >> 32);
+		}
+
+		static inline u64 tag_of(u64 h) { return h & ~POS_MASK; }
+		static inline u64 growth_of(u64 cap) { return cap - cap / 4; }
+
+		inline u64 mask() const { return index.size() - 1; }
+		inline u64 home_of(u64 slot) const { return (slot >> 32) & mask(); }
+
+		iterator make_itr(u64 pos) const
+		{
+			value_type* p = entries.data();
+			return {p + pos, p + size() - 1};
+		}
+
+		template <typename Q>
+		u64 find_slot(const Q& _k, u64 h) const;
+
+		template <typename Q, class Fn>
+		void find_slots(const Q* keys, u64 n, Fn&& fn) const;
+
+		u64 free_slot(u64 h) const;
+		void erase_slot(u64 i);
+
+		// Appends an entry for _k, known absent, with hash h
+		template <typename Q, typename... Args>
+		iterator emplace_new(u64 h, Q&& _k, Args&&... args);
+
+	protected:
+		entry_array entries;
+		index_array index;
+		[[no_unique_address]] probe_counter probe_stat;
+
+	public:
+		static constexpr Hasher hash_fn {};
+		static const iterator npos;
+	};
+
+	template <class K, class V, class Hasher>
+	const typename dense_hash_map<K, V, Hasher>::iterator
+	        dense_hash_map<K, V, Hasher>::npos;
+
+	// Deduction Guide
+	template <class K, class V>
+	dense_hash_map(const std::initializer_list<pair<K, V>>&)
+	        -> dense_hash_map<K, V>;
+
+	template <class K, class V, class Hasher>
+	dense_hash_map<K, V, Hasher>::
+	        dense_hash_map(const std::initializer_list<value_type>& ilist)
+	{
+		reserve(ilist.size());
+		for (const auto& i: ilist) insert(i);
+	}
+
+	template <class K, class V, class Hasher>
+	dense_hash_map<K, V, Hasher>&
+	dense_hash_map<K, V, Hasher>::move(self_type& src)
+	{
+		entries.move(src.entries);
+		index.move(src.index);
+		return *this;
+	}
+
+	// Slot holding _k, capacity() if none
+	template <class K, class V, class Hasher>
+	template <typename Q>
+	u64 dense_hash_map<K, V, Hasher>::find_slot(const Q& _k, u64 h) const
+	{
+		if (index.empty()) return 0;
+
+		const u64 tag = tag_of(h);
+		for (u64 i = (h >> 32) & mask(), n = 1;; i = (i + 1) & mask(), ++n)
+		{
+			const u64 s = index[i];
+			if (s == 0 || (tag_of(s) == tag && entries[(s & POS_MASK) - 1].first == _k))
+			{
+				probe_stat.add(n);
+				return s == 0 ? capacity() : i;
+			}
+		}
+	}
+
+	template <class K, class V, class Hasher>
+	u64 dense_hash_map<K, V, Hasher>::free_slot(u64 h) const
+	{
+		u64 i = (h >> 32) & mask();
+		while (index[i] != 0) i = (i + 1) & mask();
+		return i;
+	}
+
+	template <class K, class V, class Hasher>
+	void dense_hash_map<K, V, Hasher>::rehash(u64 new_cap)
+	{
+		u64 cap = 8;
+		while (cap < new_cap || growth_of(cap) < size()) cap <<= 1;
+
+		index_array tmp(cap, 0);
+		index.move(tmp);
+		for (u64 pos = 0; pos < size(); ++pos)
+		{
+			u64 h = hash_of(entries[pos].first);
+			index[free_slot(h)] = tag_of(h) | (pos + 1);
+		}
+	}
+
+	template <class K, class V, class Hasher>
+	void dense_hash_map<K, V, Hasher>::reserve(u64 n)
+	{
+		if (growth_of(capacity()) < n) rehash(n + n / 3 + 1);
+		entries.reserve(n);
+	}
+
+	template <class K, class V, class Hasher>
+	template <Lookup_Key<K, Hasher> Q>
+	typename dense_hash_map<K, V, Hasher>::iterator
+	dense_hash_map<K, V, Hasher>::find(const Q& _k) const
+	{
+		u64 i = find_slot(_k, hash_of(_k));
+		if (i == capacity()) return npos;
+		return make_itr((index[i] & POS_MASK) - 1);
+	}
+
+	template <class K, class V, class Hasher>
+	template <Lookup_Key<K, Hasher> Q>
+	bool dense_hash_map<K, V, Hasher>::contains(const Q& _k) const
+	{
+		return find_slot(_k, hash_of(_k)) != capacity();
+	}
+
+	template <class K, class V, class Hasher>
+	template <typename Q, class Fn>
+	void dense_hash_map<K, V, Hasher>::
+	        find_slots(const Q* keys, u64 n, Fn&& fn) const
+	{
+		if (index.empty())
+		{
+			for (u64 i = 0; i < n; ++i) fn(i, 0);
+			return;
+		}
+
+		u64 h[BATCH];
+		for (u64 st = 0; st < n; st += BATCH)
+		{
+			const u64 m = nuts::min(BATCH, n - st);
+			for (u64 j = 0; j < m; ++j)
+			{
+				h[j] = hash_of(keys[st + j]);
+				__builtin_prefetch(&index[(h[j] >> 32) & mask()]);
+			}
+			for (u64 j = 0; j < m; ++j)
+			{
+				const u64 s = index[(h[j] >> 32) & mask()];
+				if (s != 0) __builtin_prefetch(&entries[(s & POS_MASK) - 1]);
+			}
+			for (u64 j = 0; j < m; ++j)
+				fn(st + j, find_slot(keys[st + j], h[j]));
+		}
+	}
+
+	template <class K, class V, class Hasher>
+	template <Lookup_Key<K, Hasher> Q>
+	void dense_hash_map<K, V, Hasher>::
+	        find_many(const Q* keys, u64 n, iterator* out) const
+	{
+		find_slots(keys, n, [&](u64 i, u64 slot) {
+			out[i] = slot == capacity() ? npos
+			                            : make_itr((index[slot] & POS_MASK) - 1);
+		});
+	}
+
+	template <class K, class V, class Hasher>
+	template <Lookup_Key<K, Hasher> Q>
+	u64 dense_hash_map<K, V, Hasher>::
+	        contains_many(const Q* keys, u64 n, bool* out) const
+	{
+		u64 res = 0;
+		find_slots(keys, n, [&](u64 i, u64 slot) {
+			res += out[i] = slot != capacity();
+		});
+		return res;
+	}
+
+	template <class K, class V, class Hasher>
+	V& dense_hash_map<K, V, Hasher>::at(const K& _k)
+	{
+		auto it = find(_k);
+		assert(it != npos);
+		return it->second;
+	}
+
+	template <class K, class V, class Hasher>
+	const V& dense_hash_map<K, V, Hasher>::at(const K& _k) const
+	{
+		auto it = find(_k);
+		assert(it != npos);
+		return it->second;
+	}
+
+	template <class K, class V, class Hasher>
+	template <typename Q, typename... Args>
+	    requires Lookup_Key<Q, K, Hasher>
+	pair<typename dense_hash_map<K, V, Hasher>::iterator, bool>
+	dense_hash_map<K, V, Hasher>::try_emplace(Q&& _k, Args&&... args)
+	{
+		const u64 h = hash_of(_k);
+		u64 i = find_slot(_k, h);
+		if (i != capacity())
+			return {make_itr((index[i] & POS_MASK) - 1), false};
+		return {emplace_new(h, static_cast<Q&&>(_k), static_cast<Args&&>(args)...), true};
+	}
+
+	template <class K, class V, class Hasher>
+	template <typename Q, typename M>
+	    requires Lookup_Key<Q, K, Hasher>
+	pair<typename dense_hash_map<K, V, Hasher>::iterator, bool>
+	dense_hash_map<K, V, Hasher>::insert_or_assign(Q&& _k, M&& _val)
+	{
+		const u64 h = hash_of(_k);
+		u64 i = find_slot(_k, h);
+		if (i != capacity())
+		{
+			u64 pos = (index[i] & POS_MASK) - 1;
+			entries[pos].second = static_cast<M&&>(_val);
+			return {make_itr(pos), false};
+		}
+		return {emplace_new(h, static_cast<Q&&>(_k), static_cast<M&&>(_val)), true};
+	}
+
+	template <class K, class V, class Hasher>
+	template <typename Q, typename... Args>
+	typename dense_hash_map<K, V, Hasher>::iterator
+	dense_hash_map<K, V, Hasher>::emplace_new(u64 h, Q&& _k, Args&&... args)
+	{
+		assert(size() < POS_MASK);
+		if (size() + 1 > growth_of(capacity())) rehash(capacity() * 2);
+		entries.emplace_back(value_type(in_place, static_cast<Q&&>(_k),
+		                                static_cast<Args&&>(args)...));
+		index[free_slot(h)] = tag_of(h) | size();
+		return make_itr(size() - 1);
+	}
+
+	template <class K, class V, class Hasher>
+	void dense_hash_map<K, V, Hasher>::erase_slot(u64 i)
+	{
+		const u64 pos = (index[i] & POS_MASK) - 1;
+
+		// Backward shift: pull later slots of the run into the hole
+		// unless their home lies cyclically in (hole, j]
+		u64 hole = i;
+		for (u64 j = (i + 1) & mask(); index[j] != 0; j = (j + 1) & mask())
+		{
+			if (((j - home_of(index[j])) & mask()) >= ((j - hole) & mask()))
+			{
+				index[hole] = index[j];
+				hole = j;
+			}
+		}
+		index[hole] = 0;
+
+		// Move the last entry into pos, then repoint its slot
+		const u64 last = size() - 1;
+		if (pos != last)
+		{
+			u64 s = (hash_of(entries[last].first) >> 32) & mask();
+			while ((index[s] & POS_MASK) != last + 1) s = (s + 1) & mask();
+			index[s] = tag_of(index[s]) | (pos + 1);
+			entries[pos].move(entries[last]);
+		}
+		entries.pop_back();
+	}
+
+	template <class K, class V, class Hasher>
+	template <Lookup_Key<K, Hasher> Q>
+	bool dense_hash_map<K, V, Hasher>::erase(const Q& _k)
+	{
+		u64 i = find_slot(_k, hash_of(_k));
+		if (i == capacity()) return false;
+		erase_slot(i);
+		return true;
+	}
+
+	template <class K, class V, class Hasher>
+	void dense_hash_map<K, V, Hasher>::clear()
+	{
+		if (!empty())
+		{
+			entries.clear();
+			memset(index.data(), 0, sizeof(u64) * capacity());
+		}
+	}
+
+	template <class K, class V, class Hasher>
+	hash_stats dense_hash_map<K, V, Hasher>::stats() const
+	{
+		hash_stats res;
+		res.size = size();
+		res.buckets = capacity();
+		res.bytes = sizeof(*this) + index.capacity() * sizeof(u64) +
+		            entries.capacity() * sizeof(value_type);
+		for (u64 i = 0; i < capacity(); ++i)
+		{
+			if (index[i] == 0)
+				++res.empty_buckets;
+			else
+				res.add_chain(((i - home_of(index[i])) & mask()) + 1);
+		}
+		probe_stat.fill(res);
+		return res;
+	}
+
+	template <class K, class V, class Hasher>
+	void dense_hash_map<K, V, Hasher>::print() const
+	{
+		auto pr = [&](const auto& x) {
+			nuts::print(x);
+			if (&x != &back()) printf(", ");
+		};
+
+		printf("dense_hash_map = {");
+		for_each(*this, pr);
+		printf("}\n");
+	}
+}
+
+#endif
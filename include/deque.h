@@ -13,15 +13,17 @@
 
 namespace nuts
 {
-	template <typename T, u64 Buf = GET_BLOCK_CAPACITY(T)>
+	template <typename T, u64 Buf = GET_BLOCK_CAPACITY(T),
+	          Allocator Alloc = allocator<T>>
 	class deque
 	{
 	public:
 		using value_type = T;
 		using pointer = T*;
 		using const_pointer = const T*;
+		using allocator_type = Alloc;
 		using buf_type = array<T, Buf>;
-		using map_type = list<buf_type>;
+		using map_type = list<buf_type, rebind_alloc<Alloc, buf_type>>;
 
 		class iterator
 		    : public bidirectional_iterator
@@ -153,9 +155,10 @@ namespace nuts
 		}
 
 		deque() = default;
+		explicit deque(const Alloc& a) : impl(a) {}
 		deque(const std::initializer_list<T>& ilist);
-		deque(const deque<T, Buf>& src);
-		deque(deque<T, Buf>&& src) { move(src); }
+		deque(const deque<T, Buf, Alloc>& src);
+		deque(deque<T, Buf, Alloc>&& src) { move(src); }
 		~deque() = default;
 
 		inline T* data() const { return (pointer) impl.data(); }
@@ -163,6 +166,7 @@ namespace nuts
 		inline bool empty() const { return size() == 0; }
 		void clear();
 		static constexpr u64 block_capacity() { return Buf; }
+		inline Alloc get_allocator() const { return impl.get_allocator(); }
 
 		inline T& front() { return *begin(); }
 		inline T& back() { return *end(); }
@@ -175,9 +179,9 @@ namespace nuts
 		T& at(u64 _n);
 		const T& at(u64 _n) const;
 
-		deque<T, Buf>& operator=(const deque<T, Buf>& src);
-		deque<T, Buf>& operator=(deque<T, Buf>&& src) { return move(src); }
-		deque<T, Buf>& move(deque<T, Buf>& src);
+		deque<T, Buf, Alloc>& operator=(const deque<T, Buf, Alloc>& src);
+		deque<T, Buf, Alloc>& operator=(deque<T, Buf, Alloc>&& src) { return move(src); }
+		deque<T, Buf, Alloc>& move(deque<T, Buf, Alloc>& src);
 
 		void emplace_back(const T& val);
 		void emplace_back(T&& val);
@@ -215,20 +219,20 @@ namespace nuts
 	template <class T>
 	deque(const std::initializer_list<T>&) -> deque<T>;
 
-	template <typename T, u64 Buf>
-	deque<T, Buf>::deque(const std::initializer_list<T>& ilist)
+	template <typename T, u64 Buf, Allocator Alloc>
+	deque<T, Buf, Alloc>::deque(const std::initializer_list<T>& ilist)
 	{
 		for (const T& x: ilist) push_back(x);
 	}
 
-	template <typename T, u64 Buf>
-	deque<T, Buf>::deque(const deque<T, Buf>& src)
+	template <typename T, u64 Buf, Allocator Alloc>
+	deque<T, Buf, Alloc>::deque(const deque<T, Buf, Alloc>& src)
 	{
 		for (const T& x: range(src)) push_back(x);
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::clear()
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::clear()
 	{
 		if (!empty())
 		{
@@ -237,8 +241,8 @@ namespace nuts
 		}
 	}
 
-	template <typename T, u64 Buf>
-	deque<T, Buf>& deque<T, Buf>::move(deque<T, Buf>& src)
+	template <typename T, u64 Buf, Allocator Alloc>
+	deque<T, Buf, Alloc>& deque<T, Buf, Alloc>::move(deque<T, Buf, Alloc>& src)
 	{
 		impl.move(src.impl);
 		_size = src.size();
@@ -248,59 +252,59 @@ namespace nuts
 		return *this;
 	}
 
-	template <typename T, u64 Buf>
-	inline bool deque<T, Buf>::is_back_full() const
+	template <typename T, u64 Buf, Allocator Alloc>
+	inline bool deque<T, Buf, Alloc>::is_back_full() const
 	{
 		return last == &impl.back()[Buf - 1] ||
 		       last == (&impl.back()[0]) - 1;
 	}
 
-	template <typename T, u64 Buf>
-	inline bool deque<T, Buf>::is_front_full() const
+	template <typename T, u64 Buf, Allocator Alloc>
+	inline bool deque<T, Buf, Alloc>::is_front_full() const
 	{
 		return first == &impl.front()[0] ||
 		       first == (&impl.front()[Buf - 1]) + 1;
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::allocate_back()
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::allocate_back()
 	{
 		impl.emplace_back();
 		last = &impl.back()[0];
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::allocate_front()
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::allocate_front()
 	{
 		impl.emplace_front();
 		first = &impl.front()[Buf - 1];
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::free_front()
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::free_front()
 	{
 		impl.pop_front();
 		first = &impl.front()[0];
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::free_back()
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::free_back()
 	{
 		impl.pop_back();
 		last = &impl.back()[Buf - 1];
 	}
 
-	template <class T, u64 Buf>
-	deque<T, Buf>& deque<T, Buf>::
-	operator=(const deque<T, Buf>& src)
+	template <class T, u64 Buf, Allocator Alloc>
+	deque<T, Buf, Alloc>& deque<T, Buf, Alloc>::
+	operator=(const deque<T, Buf, Alloc>& src)
 	{
 		clear();
 		for_each(src, [&](const T& x) { emplace_back(x); });
 		return *this;
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::emplace_back(T&& val)
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::emplace_back(T&& val)
 	{
 		if (empty()) {
 			allocate_back();
@@ -316,8 +320,8 @@ namespace nuts
 		++_size;
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::emplace_back(const T& val)
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::emplace_back(const T& val)
 	{
 		if (empty()) {
 			allocate_back();
@@ -333,8 +337,8 @@ namespace nuts
 		++_size;
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::emplace_front(T&& val)
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::emplace_front(T&& val)
 	{
 		if (empty()) {
 			allocate_front();
@@ -350,8 +354,8 @@ namespace nuts
 		++_size;
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::emplace_front(const T& val)
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::emplace_front(const T& val)
 	{
 		if (empty()) {
 			allocate_front();
@@ -367,32 +371,32 @@ namespace nuts
 		++_size;
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::push_back(const T& val)
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::push_back(const T& val)
 	{
 		emplace_back(val);
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::push_front(const T& val)
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::push_front(const T& val)
 	{
 		emplace_front(val);
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::push_back(T&& val)
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::push_back(T&& val)
 	{
 		emplace_back(nuts::move(val));
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::push_front(T&& val)
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::push_front(T&& val)
 	{
 		emplace_front(nuts::move(val));
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::pop_back()
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::pop_back()
 	{
 		if (!empty())
 		{
@@ -403,8 +407,8 @@ namespace nuts
 		}
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::pop_front()
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::pop_front()
 	{
 		if (!empty())
 		{
@@ -415,8 +419,8 @@ namespace nuts
 		}
 	}
 
-	template <typename T, u64 Buf>
-	T& deque<T, Buf>::operator[](u64 _n)
+	template <typename T, u64 Buf, Allocator Alloc>
+	T& deque<T, Buf, Alloc>::operator[](u64 _n)
 	{
 		u64 head_len = (&impl.front().back() - first) + 1,
 		    tail_len = (last - &impl.back().front()) + 1,
@@ -441,8 +445,8 @@ namespace nuts
 		return *(last + 1);
 	}
 
-	template <typename T, u64 Buf>
-	const T& deque<T, Buf>::operator[](u64 _n) const
+	template <typename T, u64 Buf, Allocator Alloc>
+	const T& deque<T, Buf, Alloc>::operator[](u64 _n) const
 	{
 		u64 head_len = &impl.front().back() - first + 1,
 		    tail_len = last - &impl.back().front() + 1,
@@ -467,8 +471,8 @@ namespace nuts
 		return *(last + 1);
 	}
 
-	template <typename T, u64 Buf>
-	T& deque<T, Buf>::at(u64 _n)
+	template <typename T, u64 Buf, Allocator Alloc>
+	T& deque<T, Buf, Alloc>::at(u64 _n)
 	{
 		assert(_n > size());
 		u64 head_len = &impl.front().back() - first + 1,
@@ -494,8 +498,8 @@ namespace nuts
 		return *(last + 1);
 	}
 
-	template <typename T, u64 Buf>
-	const T& deque<T, Buf>::at(u64 _n) const
+	template <typename T, u64 Buf, Allocator Alloc>
+	const T& deque<T, Buf, Alloc>::at(u64 _n) const
 	{
 		assert(_n < size());
 		u64 head_len = &impl.front().back() - first + 1,
@@ -521,8 +525,8 @@ namespace nuts
 		return *(last + 1);
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::print() const
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::print() const
 	{
 		auto print = [&](const auto& x) {
 			nuts::print(x);
@@ -534,8 +538,8 @@ namespace nuts
 		printf("]\n");
 	}
 
-	template <typename T, u64 Buf>
-	void deque<T, Buf>::print_detail() const
+	template <typename T, u64 Buf, Allocator Alloc>
+	void deque<T, Buf, Alloc>::print_detail() const
 	{
 		auto array_print = [&](const buf_type& arr) {
 			printf("[");
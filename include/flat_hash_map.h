@@ -0,0 +1,137 @@
+#ifndef _NUTS_FLAT_HASH_MAP_
+#define _NUTS_FLAT_HASH_MAP_
+
+#include "flat_hash_set.h"
+#include "utility.h"
+
+namespace nuts
+{
+	template <typename K, typename V,
+	          typename Hasher = nuts::hash<K>>
+	class flat_hash_map
+	    : public flat_hash_set<pair<K, V>, Hasher, select_first<pair<K, V>>>
+	{
+	public:
+		using value_type = pair<K, V>;
+		using k_type = K;
+		using v_type = V;
+		using base_type = flat_hash_set<pair<K, V>, Hasher,
+		                                select_first<pair<K, V>>>;
+		using self_type = flat_hash_map<K, V, Hasher>;
+		using itr_type = typename base_type::iterator;
+
+		using base_type::_capacity;
+		using base_type::npos;
+		using base_type::slots;
+
+		flat_hash_map() = default;
+		flat_hash_map(const self_type& src) : base_type(src) {}
+		flat_hash_map(self_type&& src) { base_type::move(src); }
+		flat_hash_map(const std::initializer_list<value_type>& ilist);
+		~flat_hash_map() = default;
+
+		self_type& move(self_type& src);
+
+		V& at(const K& _k);
+		const V& at(const K& _k) const;
+
+		V& operator[](const K& _k);
+		const V& operator[](const K& _k) const { return at(_k); }
+
+		void insert(const K& _k, const V& _val);
+		void insert(const pair<K, V>& _p);
+
+		self_type& operator=(const self_type& src);
+		self_type& operator=(self_type&& src) { return move(src); }
+
+		void print() const;
+	};
+
+	// Deduction Guide
+	template <class K, class V>
+	flat_hash_map(const std::initializer_list<pair<K, V>>&)
+	        -> flat_hash_map<K, V>;
+
+	template <class K, class V, class Hasher>
+	flat_hash_map<K, V, Hasher>::
+	        flat_hash_map(const std::initializer_list<value_type>& ilist)
+	{
+		base_type::reserve(ilist.size());
+		for (const auto& i: ilist) insert(i);
+	}
+
+	template <class K, class V, class Hasher>
+	flat_hash_map<K, V, Hasher>&
+	flat_hash_map<K, V, Hasher>::move(self_type& src)
+	{
+		base_type::move(src);
+		return *this;
+	}
+
+	template <class K, class V, class Hasher>
+	flat_hash_map<K, V, Hasher>&
+	flat_hash_map<K, V, Hasher>::operator=(const self_type& src)
+	{
+		base_type::operator=(src);
+		return *this;
+	}
+
+	template <class K, class V, class Hasher>
+	V& flat_hash_map<K, V, Hasher>::at(const K& _k)
+	{
+		auto it = base_type::find(_k);
+		assert(it != npos);
+		return it->second;
+	}
+
+	template <class K, class V, class Hasher>
+	const V& flat_hash_map<K, V, Hasher>::at(const K& _k) const
+	{
+		auto it = base_type::find(_k);
+		assert(it != npos);
+		return it->second;
+	}
+
+	template <class K, class V, class Hasher>
+	V& flat_hash_map<K, V, Hasher>::operator[](const K& _k)
+	{
+		u64 h = base_type::hash_of(_k);
+		u64 i = base_type::find_index(_k, h);
+		if (i == _capacity)
+		{
+			i = base_type::prepare_insert(h);
+			(void) *new (slots + i) value_type();
+			slots[i].first = _k;
+		}
+		return slots[i].second;
+	}
+
+	template <class K, class V, class Hasher>
+	void flat_hash_map<K, V, Hasher>::
+	        insert(const K& _k, const V& _val)
+	{
+		(*this)[_k] = _val;
+	}
+
+	template <class K, class V, class Hasher>
+	void flat_hash_map<K, V, Hasher>::
+	        insert(const pair<K, V>& _p)
+	{
+		(*this)[_p.first] = _p.second;
+	}
+
+	template <class K, class V, class Hasher>
+	void flat_hash_map<K, V, Hasher>::print() const
+	{
+		auto pr = [&](const auto& x) {
+			nuts::print(x);
+			if (&x != &base_type::back()) printf(", ");
+		};
+
+		printf("flat_hash_map = {");
+		for_each(*this, pr);
+		printf("}\n");
+	}
+}
+
+#endif
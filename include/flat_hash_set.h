@@ -0,0 +1,601 @@
+#ifndef _NUTS_FLAT_HASH_SET_
+#define _NUTS_FLAT_HASH_SET_
+
+/** @file flat_hash_set
+     *  Open-addressing hash table, keys are stored inline in one slot array
+     *  Each slot owns a control byte, probed 16 at a time by SSE2 (or scalar)
+     *  Control byte: empty = 0b10000000, deleted = 0b11111110, full = 0b0xxxxxxx (H2)
+     */
+
+#include <cassert>
+#include <cstring>
+#include <new>
+
+#include "algorithm.h"
+#include "functional.h"
+#include "hash_stats.h"
+#include "iterator.h"
+#include "move.h"
+#include "type.h"
+
+#if defined(__SSE2__) && !defined(NUTS_NO_SIMD)
+#include <emmintrin.h>
+#define NUTS_FLAT_SSE2 1
+#endif
+
+namespace nuts
+{
+	static constexpr i8 FLAT_EMPTY = -128;
+	static constexpr i8 FLAT_DELETED = -2;
+	static constexpr u64 FLAT_GROUP_WIDTH = 16;
+
+	// A window of 16 control bytes, every match returns a bitmask
+	struct flat_group
+	{
+#ifdef NUTS_FLAT_SSE2
+		__m128i ctrl;
+
+		explicit flat_group(const i8* pos)
+		    : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+		inline u32 match(i8 h2) const
+		{
+			return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl));
+		}
+
+		inline u32 match_empty() const { return match(FLAT_EMPTY); }
+
+		inline u32 match_empty_or_deleted() const
+		{
+			// Both empty and deleted are less than -1, full slots are non-negative
+			return _mm_movemask_epi8(_mm_cmplt_epi8(ctrl, _mm_set1_epi8(-1)));
+		}
+#else
+		const i8* ctrl;
+
+		explicit flat_group(const i8* pos) : ctrl(pos) {}
+
+		inline u32 match(i8 h2) const
+		{
+			u32 res = 0;
+			for (u32 i = 0; i < FLAT_GROUP_WIDTH; ++i)
+				res |= static_cast<u32>(ctrl[i] == h2) << i;
+			return res;
+		}
+
+		inline u32 match_empty() const { return match(FLAT_EMPTY); }
+
+		inline u32 match_empty_or_deleted() const
+		{
+			u32 res = 0;
+			for (u32 i = 0; i < FLAT_GROUP_WIDTH; ++i)
+				res |= static_cast<u32>(ctrl[i] < -1) << i;
+			return res;
+		}
+#endif
+	};
+
+	template <typename T, typename Hasher = hash<T>,
+	          typename KeyOf = identity<T>>
+	class flat_hash_set
+	{
+	public:
+		using value_type = T;
+		using key_type = typename KeyOf::type;
+		using self_type = flat_hash_set<T, Hasher, KeyOf>;
+
+		class iterator
+		    : public forward_iterator
+		{
+		public:
+			using value_type = T;
+
+		protected:
+			const i8* ctrl = nullptr;
+			const i8* ctrl_end = nullptr;
+			T* slot = nullptr;
+
+			void skip()
+			{
+				while (ctrl != ctrl_end && *ctrl < 0) ++ctrl, ++slot;
+				if (ctrl == ctrl_end)
+				{
+					ctrl = ctrl_end = nullptr;
+					slot = nullptr;
+				}
+			}
+
+		public:
+			iterator() = default;
+			iterator(const i8* c, const i8* e, T* s)
+			    : ctrl(c), ctrl_end(e), slot(s) {}
+			iterator(const iterator& src) = default;
+			~iterator() = default;
+
+			iterator& operator=(const iterator& src) = default;
+
+			T* get() const { return slot; }
+			T& operator*() const { return *slot; }
+			T* operator->() const { return slot; }
+
+			iterator& operator++()
+			{
+				if (slot != nullptr)
+				{
+					++ctrl, ++slot;
+					skip();
+				}
+				return *this;
+			}
+
+			iterator operator++(int)
+			{
+				iterator res = *this;
+				++(*this);
+				return res;
+			}
+
+			iterator operator+(u64 bias)
+			        const { return nuts::advance(*this, bias); }
+
+			void operator+=(i64 bias)
+			{
+				while (bias--) ++(*this);
+			}
+
+			inline bool operator==(const iterator& x) const { return slot == x.slot; }
+			inline bool operator!=(const iterator& x) const { return slot != x.slot; }
+		};
+
+		iterator begin() const;
+		iterator end() const;
+
+		flat_hash_set() = default;
+		flat_hash_set(const self_type& src);
+		flat_hash_set(self_type&& src) { move(src); }
+		flat_hash_set(const std::initializer_list<T>& ilist);
+		~flat_hash_set() { drop(); }
+
+		T& front() { return *begin(); }
+		T& back() { return *end(); }
+		const T& front() const { return *begin(); }
+		const T& back() const { return *end(); }
+
+		inline u64 size() const { return _size; }
+		inline u64 capacity() const { return _capacity; }
+		inline bool empty() const { return _size == 0; }
+		self_type& move(self_type& src);
+
+		iterator find(const key_type& _k) const;
+		bool contains(const key_type& _k) const;
+
+		// Batched lookups of keys[0, n): hash and prefetch every first group, then resolve
+		void find_many(const key_type* keys, u64 n, iterator* out) const;
+		u64 contains_many(const key_type* keys, u64 n, bool* out) const;// Returns the hit count
+
+		void insert(const T& _x);
+		void insert(T&& _x);
+		bool erase(const key_type& _k);
+		void rehash(u64 new_cap);
+		void reserve(u64 n);
+		void clear();
+
+		self_type& operator=(const self_type& src);
+		self_type& operator=(self_type&& src) { return move(src); }
+
+		// Histogram of groups probed to reach each element, empty covers tombstones too
+		hash_stats stats() const;
+
+		void print() const;
+
+	protected:
+		static inline u64 hash_of(const key_type& _k)
+		{
+			// Mix the user hash, identity-like hashers must not collapse into one group
+			u64 h = hash_fn(_k) * 0x9e3779b97f4a7c15ULL;
+			return h ^ (h >> 32);
+		}
+
+		static inline u64 h1(u64 h) { return h >> 7; }
+		static inline i8 h2(u64 h) { return static_cast<i8>(h & 0x7f); }
+
+		static inline u64 growth_of(u64 cap) { return cap - cap / 8; }
+
+		inline void set_ctrl(u64 i, i8 c) { ctrl[i] = c; }
+
+		static constexpr u64 BATCH = 16;
+
+		u64 find_index(const key_type& _k, u64 h) const;
+
+		template <class Fn>
+		void find_indexes(const key_type* keys, u64 n, Fn&& fn) const;
+
+		u64 find_free(u64 h) const;
+		u64 prepare_insert(u64 h);
+		void erase_at(u64 i);
+		void drop();
+
+		static void allocate(i8*& c, T*& s, u64 cap);
+		static void deallocate(i8* c, T* s);
+
+	protected:
+		i8* ctrl = nullptr;
+		T* slots = nullptr;
+		u64 _capacity = 0;
+		u64 _size = 0;
+		u64 growth_left = 0;
+		[[no_unique_address]] probe_counter probe_stat;
+
+	public:
+		static constexpr Hasher hash_fn {};
+		static constexpr KeyOf key_of {};
+		static const iterator npos;
+	};
+
+	template <class T, class Hasher, class KeyOf>
+	const typename flat_hash_set<T, Hasher, KeyOf>::iterator
+	        flat_hash_set<T, Hasher, KeyOf>::npos;
+
+	// Deduction Guide
+	template <class K>
+	flat_hash_set(const std::initializer_list<K>&) -> flat_hash_set<K>;
+
+	template <class T, class Hasher, class KeyOf>
+	void flat_hash_set<T, Hasher, KeyOf>::
+	        allocate(i8*& c, T*& s, u64 cap)
+	{
+		c = new i8[cap];
+		memset(c, FLAT_EMPTY, cap);
+		s = static_cast<T*>(::operator new(sizeof(T) * cap,
+		                                   std::align_val_t {alignof(T)}));
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	void flat_hash_set<T, Hasher, KeyOf>::
+	        deallocate(i8* c, T* s)
+	{
+		delete[] c;
+		::operator delete(s, std::align_val_t {alignof(T)});
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	typename flat_hash_set<T, Hasher, KeyOf>::iterator
+	flat_hash_set<T, Hasher, KeyOf>::begin() const
+	{
+		if (empty()) return npos;
+		iterator res {ctrl, ctrl + _capacity, slots};
+		return *ctrl < 0 ? ++res : res;
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	typename flat_hash_set<T, Hasher, KeyOf>::iterator
+	flat_hash_set<T, Hasher, KeyOf>::end() const
+	{
+		if (empty()) return npos;
+		u64 i = _capacity;
+		while (ctrl[--i] < 0) {}
+		return {ctrl + i, ctrl + _capacity, slots + i};
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	flat_hash_set<T, Hasher, KeyOf>::
+	        flat_hash_set(const self_type& src)
+	{
+		*this = src;
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	flat_hash_set<T, Hasher, KeyOf>::
+	        flat_hash_set(const std::initializer_list<T>& ilist)
+	{
+		reserve(ilist.size());
+		for (const auto& x: ilist) insert(x);
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	flat_hash_set<T, Hasher, KeyOf>&
+	flat_hash_set<T, Hasher, KeyOf>::operator=(const self_type& src)
+	{
+		if (this == &src) return *this;
+		drop();
+		if (src._capacity != 0)
+		{
+			allocate(ctrl, slots, src._capacity);
+			memcpy(ctrl, src.ctrl, src._capacity);
+			for (u64 i = 0; i < src._capacity; ++i)
+				if (ctrl[i] >= 0)
+					(void) *new (slots + i) T(src.slots[i]);
+		}
+		_capacity = src._capacity;
+		_size = src._size;
+		growth_left = src.growth_left;
+		return *this;
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	flat_hash_set<T, Hasher, KeyOf>&
+	flat_hash_set<T, Hasher, KeyOf>::move(self_type& src)
+	{
+		if (this == &src) return *this;
+		drop();
+		ctrl = src.ctrl, slots = src.slots;
+		_capacity = src._capacity;
+		_size = src._size;
+		growth_left = src.growth_left;
+
+		src.ctrl = nullptr, src.slots = nullptr;
+		src._capacity = src._size = src.growth_left = 0;
+		return *this;
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	u64 flat_hash_set<T, Hasher, KeyOf>::
+	        find_index(const key_type& _k, u64 h) const
+	{
+		if (_capacity == 0) return _capacity;
+
+		// Triangular probing over groups, visits every group once
+		const u64 mask = _capacity / FLAT_GROUP_WIDTH - 1;
+		u64 g = h1(h) & mask, step = 1;
+		for (; step <= mask + 1; ++step)
+		{
+			const u64 base = g * FLAT_GROUP_WIDTH;
+			flat_group grp {ctrl + base};
+			for (u32 m = grp.match(h2(h)); m != 0; m &= m - 1)
+			{
+				u64 i = base + __builtin_ctz(m);
+				if (key_of(slots[i]) == _k)
+				{
+					probe_stat.add(step);
+					return i;
+				}
+			}
+			if (grp.match_empty() != 0) break;
+			g = (g + step) & mask;
+		}
+		probe_stat.add(step <= mask + 1 ? step : mask + 1);
+		return _capacity;
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	u64 flat_hash_set<T, Hasher, KeyOf>::find_free(u64 h) const
+	{
+		const u64 mask = _capacity / FLAT_GROUP_WIDTH - 1;
+		u64 g = h1(h) & mask;
+		for (u64 step = 1;; ++step)
+		{
+			const u64 base = g * FLAT_GROUP_WIDTH;
+			u32 m = flat_group {ctrl + base}.match_empty_or_deleted();
+			if (m != 0) return base + __builtin_ctz(m);
+			g = (g + step) & mask;
+		}
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	u64 flat_hash_set<T, Hasher, KeyOf>::prepare_insert(u64 h)
+	{
+		u64 i = _capacity == 0 ? 0 : find_free(h);
+		if (_capacity == 0 || (growth_left == 0 && ctrl[i] == FLAT_EMPTY))
+		{
+			// Grow if live elements exceed half the load, otherwise purge tombstones
+			u64 new_cap = _capacity == 0 ? FLAT_GROUP_WIDTH : _capacity;
+			if (_size + 1 > growth_of(new_cap) / 2) new_cap *= 2;
+			rehash(new_cap);
+			i = find_free(h);
+		}
+		if (ctrl[i] == FLAT_EMPTY) --growth_left;
+		set_ctrl(i, h2(h));
+		++_size;
+		return i;
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	void flat_hash_set<T, Hasher, KeyOf>::rehash(u64 new_cap)
+	{
+		// Capacity is a power of 2 and holds at least one group
+		u64 cap = FLAT_GROUP_WIDTH;
+		while (cap < new_cap || growth_of(cap) <= _size) cap <<= 1;
+
+		i8* old_ctrl = ctrl;
+		T* old_slots = slots;
+		u64 old_cap = _capacity;
+
+		allocate(ctrl, slots, cap);
+		_capacity = cap;
+		growth_left = growth_of(cap) - _size;
+
+		for (u64 i = 0; i < old_cap; ++i)
+		{
+			if (old_ctrl[i] >= 0)
+			{
+				u64 h = hash_of(key_of(old_slots[i]));
+				u64 j = find_free(h);
+				set_ctrl(j, h2(h));
+				(void) *new (slots + j) T(nuts::move(old_slots[i]));
+				old_slots[i].~T();
+			}
+		}
+		if (old_ctrl != nullptr)
+			deallocate(old_ctrl, old_slots);
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	void flat_hash_set<T, Hasher, KeyOf>::reserve(u64 n)
+	{
+		if (growth_of(_capacity) < n) rehash(n + n / 7 + 1);
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	typename flat_hash_set<T, Hasher, KeyOf>::iterator
+	flat_hash_set<T, Hasher, KeyOf>::find(const key_type& _k) const
+	{
+		u64 i = find_index(_k, hash_of(_k));
+		if (i == _capacity) return npos;
+		return {ctrl + i, ctrl + _capacity, slots + i};
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	bool flat_hash_set<T, Hasher, KeyOf>::
+	        contains(const key_type& _k) const
+	{
+		return find_index(_k, hash_of(_k)) != _capacity;
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	template <class Fn>
+	void flat_hash_set<T, Hasher, KeyOf>::
+	        find_indexes(const key_type* keys, u64 n, Fn&& fn) const
+	{
+		if (_capacity == 0)
+		{
+			for (u64 i = 0; i < n; ++i) fn(i, _capacity);
+			return;
+		}
+
+		const u64 mask = _capacity / FLAT_GROUP_WIDTH - 1;
+		u64 h[BATCH];
+		for (u64 st = 0; st < n; st += BATCH)
+		{
+			const u64 m = nuts::min(BATCH, n - st);
+			for (u64 j = 0; j < m; ++j)
+			{
+				h[j] = hash_of(keys[st + j]);
+				const u64 base = (h1(h[j]) & mask) * FLAT_GROUP_WIDTH;
+				__builtin_prefetch(ctrl + base);
+				__builtin_prefetch(slots + base);
+			}
+			for (u64 j = 0; j < m; ++j)
+				fn(st + j, find_index(keys[st + j], h[j]));
+		}
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	void flat_hash_set<T, Hasher, KeyOf>::
+	        find_many(const key_type* keys, u64 n, iterator* out) const
+	{
+		find_indexes(keys, n, [&](u64 i, u64 idx) {
+			out[i] = idx == _capacity ? npos
+			                          : iterator {ctrl + idx, ctrl + _capacity, slots + idx};
+		});
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	u64 flat_hash_set<T, Hasher, KeyOf>::
+	        contains_many(const key_type* keys, u64 n, bool* out) const
+	{
+		u64 res = 0;
+		find_indexes(keys, n, [&](u64 i, u64 idx) {
+			res += out[i] = idx != _capacity;
+		});
+		return res;
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	void flat_hash_set<T, Hasher, KeyOf>::insert(const T& _x)
+	{
+		u64 h = hash_of(key_of(_x));
+		if (find_index(key_of(_x), h) != _capacity) return;
+		u64 i = prepare_insert(h);
+		(void) *new (slots + i) T(_x);
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	void flat_hash_set<T, Hasher, KeyOf>::insert(T&& _x)
+	{
+		u64 h = hash_of(key_of(_x));
+		if (find_index(key_of(_x), h) != _capacity) return;
+		u64 i = prepare_insert(h);
+		(void) *new (slots + i) T(nuts::move(_x));
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	void flat_hash_set<T, Hasher, KeyOf>::erase_at(u64 i)
+	{
+		slots[i].~T();
+		--_size;
+
+		// A group that still has an empty slot never stopped a probe,
+		// so the slot can go back to empty instead of a tombstone
+		u64 base = i & ~(FLAT_GROUP_WIDTH - 1);
+		if (flat_group {ctrl + base}.match_empty() != 0)
+		{
+			set_ctrl(i, FLAT_EMPTY);
+			++growth_left;
+		}
+		else
+			set_ctrl(i, FLAT_DELETED);
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	bool flat_hash_set<T, Hasher, KeyOf>::erase(const key_type& _k)
+	{
+		u64 i = find_index(_k, hash_of(_k));
+		if (i == _capacity) return false;
+		erase_at(i);
+		return true;
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	void flat_hash_set<T, Hasher, KeyOf>::clear()
+	{
+		if (!empty())
+		{
+			for (u64 i = 0; i < _capacity; ++i)
+				if (ctrl[i] >= 0) slots[i].~T();
+			memset(ctrl, FLAT_EMPTY, _capacity);
+			_size = 0;
+			growth_left = growth_of(_capacity);
+		}
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	void flat_hash_set<T, Hasher, KeyOf>::drop()
+	{
+		if (ctrl != nullptr)
+		{
+			clear();
+			deallocate(ctrl, slots);
+			ctrl = nullptr, slots = nullptr;
+			_capacity = growth_left = 0;
+		}
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	hash_stats flat_hash_set<T, Hasher, KeyOf>::stats() const
+	{
+		hash_stats res;
+		res.size = _size;
+		res.buckets = _capacity;
+		res.bytes = sizeof(*this) + _capacity * (1 + sizeof(T));
+		const u64 mask = _capacity == 0 ? 0 : _capacity / FLAT_GROUP_WIDTH - 1;
+		for (u64 i = 0; i < _capacity; ++i)
+		{
+			if (ctrl[i] < 0)
+			{
+				++res.empty_buckets;
+				continue;
+			}
+			// Replay the triangular probe from the home group
+			u64 g = h1(hash_of(key_of(slots[i]))) & mask, len = 1;
+			for (; g != i / FLAT_GROUP_WIDTH; ++len) g = (g + len) & mask;
+			res.add_chain(len);
+		}
+		probe_stat.fill(res);
+		return res;
+	}
+
+	template <class T, class Hasher, class KeyOf>
+	void flat_hash_set<T, Hasher, KeyOf>::print() const
+	{
+		auto pr = [&](const auto& x) {
+			nuts::print(x);
+			if (&x != &back()) nuts::print(", ");
+		};
+
+		nuts::print("flat_hash_set = {");
+		for_each(*this, pr);
+		nuts::println("}");
+	}
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "type.h"
 #include "concept.h"
+#include "hash_bytes.h"
 #include <cstring>
 
 namespace nuts
@@ -75,6 +76,15 @@ namespace nuts
 		}
 	};
 
+	template <typename T>
+	struct identity
+	{
+		using type = T;
+
+		inline constexpr const T&
+		operator()(const T& x) const noexcept { return x; }
+	};
+
 	template <typename Box, typename Relation = less<>>
 	concept Sortable = Iterable<Box> &&
 	requires(typename Box::value_type x, Relation cmp)
@@ -150,28 +160,26 @@ namespace nuts
 	{
 		u64 operator()(const char* s) const
 		{
-			auto len = strlen(s);
-			u64 cnt = 0;
-
-			for (u64 i = 0; i < len; i++) {
-				cnt += (u64) s[i] & 0xbf5847;
-			}
-
-			constexpr auto hasher = [](u64 x) -> u64 {
-				x = (x ^ (x >> 30)) * u64(0xbf58476d1ce4e5b9);
-				x = (x ^ (x >> 27)) * u64(0x94d049bb133112eb);
-				x = x ^ (x >> 31);
-				return x;
-			};
-
-			return hasher(cnt);
+			return hash_bytes(s, strlen(s));
 		}
 	};
 
+	template <>
+	struct hash<char*> : hash<const char*>
+	{};
+
 	template <typename T>
 	concept Hashable = requires {
 		                   hash<T>();
 	                   };
+
+	// Q finds a K without building one: the Hasher takes Q, and K compares to Q
+	template <typename Q, typename K, typename Hasher>
+	concept Lookup_Key = requires(const Hasher& h, const Q& q, const K& k)
+	{
+		{ h(q) } -> Same<u64>;
+		{ k == q } -> Same<bool>;
+	};
 }
 
 #endif
@@ -0,0 +1,288 @@
+#ifndef _NUTS_HASH_BYTES_
+#define _NUTS_HASH_BYTES_
+
+/** @file hash_bytes
+     *  hash_bytes(p, len, seed): 64-bit hash of a byte range, dispatched by length
+     *  len <= 16: two overlapping reads, one 128-bit multiply (wyhash)
+     *  len <= 256: 16 or 48 bytes per round of 128-bit multiplies (wyhash)
+     *  len > 256: 8 lanes of 32x32->64 multiply-accumulate (xxh3 style) on SSE2/AVX2
+     *  Every path gives the same value on every CPU, the SIMD loop is exact
+     */
+
+#include <cstring>
+
+#include "simd.h"
+#include "type.h"
+
+namespace nuts
+{
+	namespace detail
+	{
+		static constexpr u64 WY_P0 = 0xa0761d6478bd642fULL;
+		static constexpr u64 WY_P1 = 0xe7037ed1a0b428dbULL;
+		static constexpr u64 WY_P2 = 0x8ebc6af09c88c6e3ULL;
+		static constexpr u64 WY_P3 = 0x589965cc75374cc3ULL;
+
+		static constexpr u64 ACC_STRIPE = 64;// Bytes per multiply-accumulate step
+		static constexpr u64 ACC_ROUNDS = 16;// Stripes between two scrambles
+		static constexpr u64 ACC_CUTOFF = 256;
+		static constexpr u32 ACC_PRIME = 0x9e3779b1U;
+
+		// Stripe s reads key[s .. s + 8), the scramble reads key[16 .. 24)
+		struct acc_secret
+		{
+			u64 key[ACC_ROUNDS + 8];
+
+			constexpr acc_secret() : key()
+			{
+				u64 x = WY_P0;
+				for (auto& k: key)
+				{
+					// splitmix64
+					u64 z = (x += 0x9e3779b97f4a7c15ULL);
+					z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+					z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+					k = z ^ (z >> 31);
+				}
+			}
+		};
+
+		static constexpr acc_secret ACC_SECRET {};
+
+		inline u64 read64(const u8* p)
+		{
+			u64 v;
+			memcpy(&v, p, 8);
+			return v;
+		}
+
+		inline u64 read32(const u8* p)
+		{
+			u32 v;
+			memcpy(&v, p, 4);
+			return v;
+		}
+
+		// a, b <- low and high half of the full 64x64 -> 128 product
+		inline void wymum(u64& a, u64& b)
+		{
+#ifdef __SIZEOF_INT128__
+			unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+			a = static_cast<u64>(r), b = static_cast<u64>(r >> 64);
+#else
+			u64 ha = a >> 32, hb = b >> 32, la = static_cast<u32>(a), lb = static_cast<u32>(b);
+			u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+			u64 t = rl + (rm0 << 32), c = t < rl;
+			u64 lo = t + (rm1 << 32);
+			c += lo < t;
+			a = lo, b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+		}
+
+		inline u64 wymix(u64 a, u64 b)
+		{
+			wymum(a, b);
+			return a ^ b;
+		}
+
+		struct acc_scalar
+		{
+			static inline void stripe(u64* acc, const u8* p, const u64* key)
+			{
+				for (u64 i = 0; i < 8; ++i)
+				{
+					u64 d = read64(p + 8 * i), dk = d ^ key[i];
+					acc[i ^ 1] += d;
+					acc[i] += (dk & 0xffffffffULL) * (dk >> 32);
+				}
+			}
+
+			static inline void scramble(u64* acc, const u64* key)
+			{
+				for (u64 i = 0; i < 8; ++i)
+				{
+					u64 a = acc[i];
+					a ^= a >> 47;
+					a ^= key[i];
+					acc[i] = a * ACC_PRIME;
+				}
+			}
+		};
+
+#ifdef NUTS_SIMD_X86
+		struct acc_sse2
+		{
+			NUTS_TARGET_SSE2 static inline void stripe(u64* acc, const u8* p, const u64* key)
+			{
+				for (u64 i = 0; i < 4; ++i)
+				{
+					__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p) + i);
+					__m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key) + i);
+					__m128i dk = _mm_xor_si128(d, k);
+					__m128i prod = _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32));
+					__m128i swap = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+					__m128i* a = reinterpret_cast<__m128i*>(acc) + i;
+					_mm_storeu_si128(a, _mm_add_epi64(_mm_loadu_si128(a),
+					                                  _mm_add_epi64(prod, swap)));
+				}
+			}
+
+			NUTS_TARGET_SSE2 static inline void scramble(u64* acc, const u64* key)
+			{
+				const __m128i prime = _mm_set1_epi32(static_cast<int>(ACC_PRIME));
+				for (u64 i = 0; i < 4; ++i)
+				{
+					__m128i* p = reinterpret_cast<__m128i*>(acc) + i;
+					__m128i a = _mm_loadu_si128(p);
+					a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+					a = _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(key) + i));
+					// 64x32 multiply from two 32x32 halves
+					__m128i lo = _mm_mul_epu32(a, prime);
+					__m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+					_mm_storeu_si128(p, _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+				}
+			}
+		};
+
+		struct acc_avx2
+		{
+			NUTS_TARGET_AVX2 static inline void stripe(u64* acc, const u8* p, const u64* key)
+			{
+				for (u64 i = 0; i < 2; ++i)
+				{
+					__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p) + i);
+					__m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key) + i);
+					__m256i dk = _mm256_xor_si256(d, k);
+					__m256i prod = _mm256_mul_epu32(dk, _mm256_srli_epi64(dk, 32));
+					__m256i swap = _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+					__m256i* a = reinterpret_cast<__m256i*>(acc) + i;
+					_mm256_storeu_si256(a, _mm256_add_epi64(_mm256_loadu_si256(a),
+					                                        _mm256_add_epi64(prod, swap)));
+				}
+			}
+
+			NUTS_TARGET_AVX2 static inline void scramble(u64* acc, const u64* key)
+			{
+				const __m256i prime = _mm256_set1_epi32(static_cast<int>(ACC_PRIME));
+				for (u64 i = 0; i < 2; ++i)
+				{
+					__m256i* p = reinterpret_cast<__m256i*>(acc) + i;
+					__m256i a = _mm256_loadu_si256(p);
+					a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+					a = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key) + i));
+					__m256i lo = _mm256_mul_epu32(a, prime);
+					__m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+					_mm256_storeu_si256(p, _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+				}
+			}
+		};
+#endif
+
+		// len > ACC_CUTOFF, the last stripe overlaps the previous one
+		template <class K>
+		inline void accumulate(u64* acc, const u8* p, u64 len)
+		{
+			const u64* key = ACC_SECRET.key;
+			const u64 stripes = (len - 1) / ACC_STRIPE;
+			u64 s = 0;
+			for (; s + ACC_ROUNDS <= stripes; s += ACC_ROUNDS)
+			{
+				for (u64 r = 0; r < ACC_ROUNDS; ++r)
+					K::stripe(acc, p + (s + r) * ACC_STRIPE, key + r);
+				K::scramble(acc, key + ACC_ROUNDS);
+			}
+			for (u64 r = 0; s < stripes; ++s, ++r)
+				K::stripe(acc, p + s * ACC_STRIPE, key + r);
+			K::stripe(acc, p + len - ACC_STRIPE, key + ACC_ROUNDS - 1);
+		}
+
+#ifdef NUTS_SIMD_X86
+		__attribute__((target("avx2"), flatten)) inline void
+		accumulate_avx2(u64* acc, const u8* p, u64 len)
+		{
+			accumulate<acc_avx2>(acc, p, len);
+		}
+
+		__attribute__((target("sse2"), flatten)) inline void
+		accumulate_sse2(u64* acc, const u8* p, u64 len)
+		{
+			accumulate<acc_sse2>(acc, p, len);
+		}
+#endif
+
+		inline u64 hash_long(const u8* p, u64 len, u64 seed)
+		{
+			u64 acc[8] = {0x9e3779b1ULL, 0x9e3779b185ebca87ULL,
+			              0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL,
+			              0x85ebca77c2b2ae63ULL, 0x85ebca77ULL,
+			              0x27d4eb2f165667c5ULL, 0x9e3779b1ULL};
+#ifdef NUTS_SIMD_X86
+			switch (simd::detect())
+			{
+				case simd::level::AVX2: accumulate_avx2(acc, p, len); break;
+				case simd::level::SSE2: accumulate_sse2(acc, p, len); break;
+				default: accumulate<acc_scalar>(acc, p, len);
+			}
+#else
+			accumulate<acc_scalar>(acc, p, len);
+#endif
+			u64 res = len * WY_P1 ^ seed;
+			for (u64 i = 0; i < 4; ++i)
+				res += wymix(acc[2 * i] ^ ACC_SECRET.key[2 * i],
+				             acc[2 * i + 1] ^ ACC_SECRET.key[2 * i + 1]);
+			return wymix(res ^ WY_P0, seed ^ WY_P1);
+		}
+	}
+
+	// Not a stable fingerprint, values may change between releases
+	inline u64 hash_bytes(const void* src, u64 len, u64 seed = 0)
+	{
+		using namespace detail;
+
+		const u8* p = static_cast<const u8*>(src);
+		if (len > ACC_CUTOFF) return hash_long(p, len, seed);
+
+		seed ^= wymix(seed ^ WY_P0, WY_P1);
+		u64 a = 0, b = 0;
+		if (len <= 16)
+		{
+			if (len >= 4)
+			{
+				const u64 q = (len >> 3) << 2;
+				a = (read32(p) << 32) | read32(p + q);
+				b = (read32(p + len - 4) << 32) | read32(p + len - 4 - q);
+			}
+			else if (len > 0)
+				a = (static_cast<u64>(p[0]) << 16) |
+				    (static_cast<u64>(p[len >> 1]) << 8) | p[len - 1];
+		}
+		else
+		{
+			u64 i = len;
+			if (i > 48)
+			{
+				u64 see1 = seed, see2 = seed;
+				do {
+					seed = wymix(read64(p) ^ WY_P1, read64(p + 8) ^ seed);
+					see1 = wymix(read64(p + 16) ^ WY_P2, read64(p + 24) ^ see1);
+					see2 = wymix(read64(p + 32) ^ WY_P3, read64(p + 40) ^ see2);
+					p += 48, i -= 48;
+				} while (i > 48);
+				seed ^= see1 ^ see2;
+			}
+			while (i > 16)
+			{
+				seed = wymix(read64(p) ^ WY_P1, read64(p + 8) ^ seed);
+				p += 16, i -= 16;
+			}
+			a = read64(p + i - 16);
+			b = read64(p + i - 8);
+		}
+
+		a ^= WY_P1, b ^= seed;
+		wymum(a, b);
+		return wymix(a ^ WY_P0 ^ len, b ^ WY_P1);
+	}
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef _NUTS_HASH_STATS_
+#define _NUTS_HASH_STATS_
+
+/** @file hash_stats
+     *  hash_stats: a snapshot of a hash table's shape, filled by stats() on every hash container
+     *  Chained tables histogram chain length per bucket, open addressing the probe length per element
+     *  Define NUTS_HASH_PROBE_STATS to also count lookups and probes (nodes, slots or groups inspected)
+     */
+
+#include <atomic>
+#include <cstdio>
+
+#include "type.h"
+
+namespace nuts
+{
+	struct hash_stats
+	{
+		static constexpr u64 BINS = 16;
+
+		u64 size = 0;
+		u64 buckets = 0;// Buckets, or slots for open addressing
+		u64 empty_buckets = 0;
+		u64 max_chain = 0;// Longest chain, or longest probe sequence
+		u64 bytes = 0;    // Table, nodes and entries, not what the elements own
+		u64 lookups = 0, probes = 0;
+
+		// [i]: chains (probe sequences) of length i, the last bin is i and up
+		u64 histogram[BINS] {};
+
+		inline void add_chain(u64 n)
+		{
+			++histogram[n < BINS ? n : BINS - 1];
+			if (n > max_chain) max_chain = n;
+		}
+
+		inline f64 load_factor() const
+		{
+			return buckets == 0 ? 0 : static_cast<f64>(size) / buckets;
+		}
+
+		inline f64 empty_ratio() const
+		{
+			return buckets == 0 ? 0 : static_cast<f64>(empty_buckets) / buckets;
+		}
+
+		inline f64 probes_per_lookup() const
+		{
+			return lookups == 0 ? 0 : static_cast<f64>(probes) / lookups;
+		}
+
+		// Sums two tables, e.g. the shards of a concurrent_hash_map
+		hash_stats& operator+=(const hash_stats& x)
+		{
+			size += x.size, buckets += x.buckets;
+			empty_buckets += x.empty_buckets;
+			if (x.max_chain > max_chain) max_chain = x.max_chain;
+			for (u64 i = 0; i < BINS; ++i) histogram[i] += x.histogram[i];
+			bytes += x.bytes;
+			lookups += x.lookups, probes += x.probes;
+			return *this;
+		}
+
+		// One line of key=value pairs
+		void print() const
+		{
+			printf("size=%llu buckets=%llu load=%.3f empty=%.3f max_chain=%llu bytes=%llu",
+			       (unsigned long long) size, (unsigned long long) buckets, load_factor(),
+			       empty_ratio(), (unsigned long long) max_chain, (unsigned long long) bytes);
+			printf(" probes/lookup=%.3f hist=", probes_per_lookup());
+			for (u64 i = 0; i < BINS; ++i)
+				printf(i == 0 ? "%llu" : ",%llu", (unsigned long long) histogram[i]);
+			printf("\n");
+		}
+	};
+
+	// Lookup and probe totals, empty unless NUTS_HASH_PROBE_STATS is defined
+	// Relaxed atomics, so readers under a shared lock may count concurrently
+	struct probe_counter
+	{
+#ifdef NUTS_HASH_PROBE_STATS
+		mutable std::atomic<u64> lookups {0}, probes {0};
+
+		// A copy is a different table, it starts counting from zero
+		probe_counter() = default;
+		probe_counter(const probe_counter&) {}
+
+		probe_counter& operator=(const probe_counter&)
+		{
+			lookups.store(0, std::memory_order_relaxed);
+			probes.store(0, std::memory_order_relaxed);
+			return *this;
+		}
+
+		inline void add(u64 n) const
+		{
+			lookups.fetch_add(1, std::memory_order_relaxed);
+			probes.fetch_add(n, std::memory_order_relaxed);
+		}
+
+		inline void fill(hash_stats& s) const
+		{
+			s.lookups = lookups.load(std::memory_order_relaxed);
+			s.probes = probes.load(std::memory_order_relaxed);
+		}
+#else
+		inline void add(u64) const {}
+		inline void fill(hash_stats&) const {}
+#endif
+	};
+}
+
+#endif
@@ -0,0 +1,317 @@
+#ifndef _NUTS_INTRUSIVE_LIST_
+#define _NUTS_INTRUSIVE_LIST_
+
+/** @file intrusive_list
+     *  intrusive_list<T, &T::hook>: a doubly linked list threaded through a list_hook inside T
+     *  The list never allocates, copies or destroys elements, it only relinks their hooks,
+     *  so insert/erase/splice are O(1) and an object with several hooks can sit in several lists
+     *  Iterators follow list.h: end() is the last element, stepping past it gives npos
+     *  Elements must be erased (or the list cleared) before they are destroyed
+     */
+
+#include <cassert>
+
+#include "algorithm.h"
+#include "iterator.h"
+#include "memory.h"
+#include "type.h"
+
+namespace nuts
+{
+	struct list_hook// Embedded link, unlinked hooks point to themselves
+	{
+		list_hook* prev = this;
+		list_hook* next = this;
+
+		list_hook() = default;
+		list_hook(const list_hook&) {}// A copy of an element starts outside every list
+		list_hook& operator=(const list_hook&) { return *this; }
+
+		inline bool linked() const { return next != this; }
+	};
+
+	template <class T, list_hook T::*Hook>
+	class intrusive_list// Manager class
+	{
+	public:
+		using value_type = T;
+		using hook_ptr = list_hook*;
+
+	protected:
+		hook_ptr head = nullptr;
+		hook_ptr tail = nullptr;
+		u64 length = 0;
+
+		// Measured once on a static buffer, also safe from other static initializers
+		static u64 hook_offset()
+		{
+			static const u64 off = [] {
+				alignas(T) static unsigned char buf[sizeof(T)];
+				auto p = reinterpret_cast<T*>(buf);
+				return static_cast<u64>(reinterpret_cast<unsigned char*>(&(p->*Hook)) - buf);
+			}();
+			return off;
+		}
+
+		static inline T* owner(hook_ptr h)
+		{
+			return reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(h) - hook_offset());
+		}
+
+		static inline hook_ptr hook_of(T& x) { return &(x.*Hook); }
+
+		void link_after(hook_ptr pos, hook_ptr h);// Link h after pos, at the front if pos is nullptr
+		void unlink(hook_ptr h);
+
+	public:
+		intrusive_list() = default;
+		intrusive_list(const intrusive_list&) = delete;// Elements can't be in two copies at once
+		intrusive_list(intrusive_list&& src) { move(src); }
+		~intrusive_list() { clear(); }// Unlink every element, nothing is freed
+
+		intrusive_list& operator=(const intrusive_list&) = delete;
+		intrusive_list& operator=(intrusive_list&& src) { return move(src); }
+
+		inline bool empty() const { return length == 0; }
+		inline u64 size() const { return length; }
+
+		class iterator
+		    : public bidirectional_iterator
+		{
+		public:
+			using value_type = T;
+
+		protected:
+			hook_ptr _ptr = nullptr;
+
+		public:
+			iterator() = default;
+			iterator(hook_ptr obj) : _ptr(obj) {}
+			iterator(const iterator& obj) : _ptr(obj._ptr) {}
+
+			hook_ptr get() const { return _ptr; }
+
+			T& operator*() const { return *owner(_ptr); }
+			T* operator->() const { return owner(_ptr); }
+
+			iterator& operator=(const iterator& obj)
+			{
+				_ptr = obj._ptr;
+				return *this;
+			}
+
+			inline bool operator==(const iterator& obj) const { return _ptr == obj._ptr; }
+			inline bool operator!=(const iterator& obj) const { return _ptr != obj._ptr; }
+
+			iterator& operator++()
+			{
+				if (_ptr != nullptr) _ptr = _ptr->next;
+				return *this;
+			}
+
+			iterator operator++(int)
+			{
+				iterator res = *this;
+				++(*this);
+				return res;
+			}
+
+			iterator& operator--()
+			{
+				if (_ptr != nullptr) _ptr = _ptr->prev;
+				return *this;
+			}
+
+			iterator operator--(int)
+			{
+				iterator res = *this;
+				--(*this);
+				return res;
+			}
+
+			iterator operator+(i64 bias) const
+			{
+				iterator res = *this;
+				return nuts::advance(res, bias);
+			}
+
+			iterator operator-(i64 bias) const
+			{
+				iterator res = *this;
+				return nuts::advance(res, -bias);
+			}
+		};
+
+		static constexpr iterator npos {};
+
+		inline iterator begin() const { return iterator(head); }
+		inline iterator end() const { return iterator(tail); }
+
+		inline T& front() const { return *owner(head); }
+		inline T& back() const { return *owner(tail); }
+
+		static iterator iterator_to(T& x) { return iterator(hook_of(x)); }// x must be linked
+		static bool linked(const T& x) { return (x.*Hook).linked(); }
+
+		intrusive_list& push_back(T& x);
+		intrusive_list& push_front(T& x);
+		intrusive_list& pop_back();
+		intrusive_list& pop_front();
+
+		intrusive_list& insert(const iterator& pos, T& x);// Link x after pos, at the front if pos is npos
+		intrusive_list& erase(T& x);                      // Unlink x, which must be in this list
+		intrusive_list& erase(const iterator& pos) { return erase(*pos); }
+
+		intrusive_list& splice(const iterator& pos, intrusive_list& other);// Move all of other after pos
+		intrusive_list& splice(const iterator& pos, intrusive_list& other, T& x);// Move x from other after pos
+
+		intrusive_list& clear();
+		intrusive_list& move(intrusive_list& src);
+	};
+
+	// Nodes never point back to the manager
+	template <class T, list_hook T::*Hook>
+	struct is_trivially_relocatable<intrusive_list<T, Hook>>
+	{
+		static constexpr bool value = true;
+	};
+
+	template <class T, list_hook T::*Hook>
+	void intrusive_list<T, Hook>::link_after(hook_ptr pos, hook_ptr h)
+	{
+		assert(!h->linked());
+		h->prev = pos;
+		h->next = pos != nullptr ? pos->next : head;
+		if (h->next != nullptr)
+			h->next->prev = h;
+		else
+			tail = h;
+		if (pos != nullptr)
+			pos->next = h;
+		else
+			head = h;
+		length++;
+	}
+
+	template <class T, list_hook T::*Hook>
+	void intrusive_list<T, Hook>::unlink(hook_ptr h)
+	{
+		assert(h->linked() && length != 0);
+		if (h->prev != nullptr)
+			h->prev->next = h->next;
+		else
+			head = h->next;
+		if (h->next != nullptr)
+			h->next->prev = h->prev;
+		else
+			tail = h->prev;
+		h->prev = h->next = h;
+		length--;
+	}
+
+	template <class T, list_hook T::*Hook>
+	intrusive_list<T, Hook>& intrusive_list<T, Hook>::push_back(T& x)
+	{
+		link_after(tail, hook_of(x));
+		return *this;
+	}
+
+	template <class T, list_hook T::*Hook>
+	intrusive_list<T, Hook>& intrusive_list<T, Hook>::push_front(T& x)
+	{
+		link_after(nullptr, hook_of(x));
+		return *this;
+	}
+
+	template <class T, list_hook T::*Hook>
+	intrusive_list<T, Hook>& intrusive_list<T, Hook>::pop_back()
+	{
+		if (!empty()) unlink(tail);
+		return *this;
+	}
+
+	template <class T, list_hook T::*Hook>
+	intrusive_list<T, Hook>& intrusive_list<T, Hook>::pop_front()
+	{
+		if (!empty()) unlink(head);
+		return *this;
+	}
+
+	template <class T, list_hook T::*Hook>
+	intrusive_list<T, Hook>& intrusive_list<T, Hook>::insert(const iterator& pos, T& x)
+	{
+		link_after(pos.get(), hook_of(x));
+		return *this;
+	}
+
+	template <class T, list_hook T::*Hook>
+	intrusive_list<T, Hook>& intrusive_list<T, Hook>::erase(T& x)
+	{
+		unlink(hook_of(x));
+		return *this;
+	}
+
+	template <class T, list_hook T::*Hook>
+	intrusive_list<T, Hook>& intrusive_list<T, Hook>::
+	        splice(const iterator& pos, intrusive_list& other)
+	{
+		if (&other == this || other.empty()) return *this;
+
+		hook_ptr p = pos.get();
+		hook_ptr nxt = p != nullptr ? p->next : head;
+		other.head->prev = p;
+		other.tail->next = nxt;
+		if (p != nullptr)
+			p->next = other.head;
+		else
+			head = other.head;
+		if (nxt != nullptr)
+			nxt->prev = other.tail;
+		else
+			tail = other.tail;
+
+		length += other.length;
+		other.head = other.tail = nullptr;
+		other.length = 0;
+		return *this;
+	}
+
+	template <class T, list_hook T::*Hook>
+	intrusive_list<T, Hook>& intrusive_list<T, Hook>::
+	        splice(const iterator& pos, intrusive_list& other, T& x)
+	{
+		hook_ptr h = hook_of(x);
+		if (pos.get() == h) return *this;
+		other.unlink(h);
+		link_after(pos.get(), h);
+		return *this;
+	}
+
+	template <class T, list_hook T::*Hook>
+	intrusive_list<T, Hook>& intrusive_list<T, Hook>::clear()
+	{
+		for (hook_ptr p = head; p != nullptr;)
+		{
+			hook_ptr nxt = p->next;
+			p->prev = p->next = p;
+			p = nxt;
+		}
+		head = tail = nullptr;
+		length = 0;
+		return *this;
+	}
+
+	template <class T, list_hook T::*Hook>
+	intrusive_list<T, Hook>& intrusive_list<T, Hook>::move(intrusive_list& src)
+	{
+		if (&src == this) return *this;
+		clear();
+		head = src.head, tail = src.tail;
+		length = src.length;
+		src.head = src.tail = nullptr;
+		src.length = 0;
+		return *this;
+	}
+}
+
+#endif
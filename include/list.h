@@ -3,6 +3,9 @@
 
 #include "algorithm.h"
 #include "iterator.h"
+#include "memory.h"
+#include "move.h"
+#include "node_pool.h"
 #include "type.h"
 
 namespace nuts
@@ -18,7 +21,10 @@ namespace nuts
 		explicit ListNode(const T& userInputData)
 		    : data(userInputData), prev(nullptr), next(nullptr) {}
 		explicit ListNode(T&& userInputData)
-		    : data(userInputData), prev(nullptr), next(nullptr) {}
+		    : data(nuts::move(userInputData)), prev(nullptr), next(nullptr) {}
+		template <typename... Args>
+		explicit ListNode(in_place_t, Args&&... args)
+		    : data(static_cast<Args&&>(args)...) {}
 		~ListNode()
 		{
 			prev = next = nullptr;
@@ -29,26 +35,44 @@ namespace nuts
 		}
 	};
 
-	template <class T>
+	template <class T, Allocator Alloc = allocator<T>>
 	class list// Manager class
 	{
 	public:
 		using value_type = T;
 		using node = ListNode<T>;
 		using node_ptr = node*;
+		using allocator_type = Alloc;
+		using node_allocator = node_alloc_t<Alloc, node>;
 
 	private:
-		list<T>& erase(node_ptr start_node, u64 N_far = 0);// Remove a node that N blocks from the start_node(reference argument)
-		list<T>& insert(node_ptr position, const T& obj, u64 num = 1);
+		list<T, Alloc>& erase(node_ptr start_node, u64 N_far = 0);// Remove a node that N blocks from the start_node(reference argument)
+		list<T, Alloc>& insert(node_ptr position, const T& obj, u64 num = 1);
+
+		void link_range(node_ptr pos, node_ptr first, node_ptr last, u64 n);// Link a detached chain after pos, at the front if pos is nullptr
+		void unlink_range(node_ptr first, node_ptr last, u64 n);           // Detach first..last, n nodes, into a chain
+
+		template <class Compare>
+		static node_ptr merge_runs(node_ptr a, node_ptr b, Compare& cmp);// Merge two next-chains, a wins ties
+		void rethread(node_ptr first);                                  // Make first the head, fix prev and tail
 
 	public:
 		list() = default;                                     // Void constructor
+		explicit list(const Alloc& a) : alloc(a) {}           // Init by an allocator
 		list(const T& userInputData, u64 userInputlength = 1);// Init by several valued nodes
-		list(const list<T>& obj);                             // Init by another list(deep copy)
-		list(list<T>&& src) { move(src); }
+		list(const list<T, Alloc>& obj);                      // Init by another list(deep copy)
+		list(list<T, Alloc>&& src) { move(src); }
 		list(const std::initializer_list<T>& ilist);// Init by a {ilist}
 		~list() { clear(); }                        // Clear and gain back memory
 
+		inline Alloc get_allocator() const
+		{
+			if constexpr (requires { Alloc(alloc); })
+				return Alloc(alloc);
+			else
+				return Alloc();// Pooled nodes of the default allocator
+		}
+
 		inline bool empty() const// Whether the list is empty
 		{
 			return size() == 0 &&
@@ -61,28 +85,36 @@ namespace nuts
 		inline bool exist() const { return empty(); }// Whether the list exists
 		inline u64 size() const { return length; }   // Get the length of the whole list
 		void print() const;                          // Print a list in console
-		list<T>& clear();                            // Clear the whole list, release all nodes
+		list<T, Alloc>& clear();                            // Clear the whole list, release all nodes
+		list<T, Alloc>& shrink();                           // Give pooled free nodes back to the system
+
+		list<T, Alloc>& operator=(const list<T, Alloc>& obj);// Copy
+		list<T, Alloc>& operator=(list<T, Alloc>&& src) { return move(src); }
+
+		template <typename... Args>
+		list<T, Alloc>& emplace_back(Args&&... args);// Add back a node built from args
+		list<T, Alloc>& push_back(const T& obj, u64 num = 1);// Add back several nodes(add by init calue)
+		list<T, Alloc>& push_back(T&& obj);
 
-		list<T>& operator=(const list<T>& obj);// Copy
-		list<T>& operator=(list<T>&& src) { return move(src); }
+		template <typename... Args>
+		list<T, Alloc>& emplace_front(Args&&... args);// Add front a node built from args
+		list<T, Alloc>& push_front(const T& obj, u64 num = 1);// Add frontseveral nodes(add by init value)
+		list<T, Alloc>& push_front(T&& obj);
 
-		list<T>& emplace_back();// Add back an empty node
-		list<T>& emplace_back(const T& val);
-		list<T>& emplace_back(T&& val);
-		list<T>& push_back(const T& obj, u64 num = 1);// Add back several nodes(add by init calue)
-		list<T>& push_back(T&& obj);
+		list<T, Alloc>& pop_back(); // Remove last element
+		list<T, Alloc>& pop_front();// Remove first element
 
-		list<T>& emplace_front();// Add front an empty node
-		list<T>& emplace_front(const T& val);
-		list<T>& emplace_front(T&& val);
-		list<T>& push_front(const T& obj, u64 num = 1);// Add frontseveral nodes(add by init value)
-		list<T>& push_front(T&& obj);
+		list<T, Alloc>& merge(list<T, Alloc>& after);// Merge lists together, the latter lost ownership(allocators must compare equal)
 
-		list<T>& pop_back(); // Remove last element
-		list<T>& pop_front();// Remove first element
+		template <class Compare>
+		list<T, Alloc>& merge(list<T, Alloc>& after, Compare cmp);// Merge two sorted lists into one sorted, stable
 
-		list<T>& merge(list<T>& after);// Merge lists together, the latter lost ownership
-		list<T>& move(list<T>& src);   // A void manager can deprive other's ownership
+		template <class Compare = less<>>
+		list<T, Alloc>& sort(Compare cmp = Compare {});// Stable bottom-up merge sort, relinks nodes only
+		list<T, Alloc>& move(list<T, Alloc>& src);   // A void manager can deprive other's ownership
+
+		node_ptr unlink(node_ptr p);          // Detach a node without freeing it, the caller owns it
+		list<T, Alloc>& link_back(node_ptr p);// Append a detached node(its allocator must compare equal)
 
 		class iterator
 		    : public bidirectional_iterator
@@ -174,6 +206,46 @@ namespace nuts
 
 		static constexpr iterator npos {};
 
+		class node_handle// Owns a node taken out by extract(), frees it unless inserted back
+		{
+		private:
+			node_ptr _ptr = nullptr;
+			[[no_unique_address]] node_allocator alloc;
+
+			friend class list;
+
+			node_ptr release()
+			{
+				node_ptr p = _ptr;
+				_ptr = nullptr;
+				return p;
+			}
+
+		public:
+			node_handle() = default;
+			node_handle(node_ptr p, const node_allocator& a) : _ptr(p), alloc(a) {}
+			node_handle(const node_handle&) = delete;
+			node_handle(node_handle&& src) : _ptr(src.release()), alloc(src.alloc) {}
+			~node_handle() { alloc_delete(alloc, _ptr); }
+
+			node_handle& operator=(const node_handle&) = delete;
+			node_handle& operator=(node_handle&& src)
+			{
+				if (this != &src)
+				{
+					alloc_delete(alloc, _ptr);
+					alloc = src.alloc;
+					_ptr = src.release();
+				}
+				return *this;
+			}
+
+			inline bool empty() const { return _ptr == nullptr; }
+			explicit operator bool() const { return !empty(); }
+
+			T& value() const { return _ptr->data; }
+		};
+
 		inline iterator begin() const { return iterator(const_cast<node_ptr>(head)); }
 		inline iterator end() const { return iterator(const_cast<node_ptr>(tail)); }
 
@@ -183,10 +255,21 @@ namespace nuts
 		inline const T& front() const { return head->data; }
 		inline const T& back() const { return tail->data; }
 
-		list<T>& insert(const iterator& pos,
+		list<T, Alloc>& insert(const iterator& pos,
 		                const T& obj, u64 num = 1);// Insert several node at position
 
-		list<T>& erase(iterator pos, u64 num = 0);
+		list<T, Alloc>& erase(iterator pos, u64 num = 0);
+
+		// Pointer surgery only, pos is npos for the front, other's allocator must compare equal
+		list<T, Alloc>& splice(const iterator& pos, list<T, Alloc>& other);// Move all of other after pos
+		list<T, Alloc>& splice(const iterator& pos, list<T, Alloc>& other,
+		                       const iterator& first, const iterator& last);// Move first..last of other after pos, counts them
+		list<T, Alloc>& splice(const iterator& pos, list<T, Alloc>& other,
+		                       const iterator& first, const iterator& last, u64 n);// Same with n known, O(1)
+
+		node_handle extract(const iterator& pos);                    // Take a node out, nothing is freed
+		list<T, Alloc>& insert(node_handle&& nh);                     // Link an extracted node at the back
+		list<T, Alloc>& insert(const iterator& pos, node_handle&& nh);// Link an extracted node after pos
 
 		template <typename Func>
 		iterator find(Func fn) const;// Find the first element match the condition
@@ -204,47 +287,56 @@ namespace nuts
 		node_ptr head = nullptr;
 		node_ptr tail = nullptr;
 		u64 length = 0;
+		[[no_unique_address]] node_allocator alloc;
 	};
 
 	// Deduction Guide
 	template <class T>
 	list(const std::initializer_list<T>&) -> list<T>;
 
-	template <class T>
-	list<T>::list(const T& userInputData, u64 userInputlength)
+	// Nodes never point back to the manager
+	template <class T, Allocator Alloc>
+	struct is_trivially_relocatable<list<T, Alloc>>
+	{
+		static constexpr bool value = true;
+	};
+
+	template <class T, Allocator Alloc>
+	list<T, Alloc>::list(const T& userInputData, u64 userInputlength)
 	{
 		push_back(userInputData, userInputlength);// better way
 	}
 
-	template <class T>
+	template <class T, Allocator Alloc>
 	template <Forward_Itr Itr>
-	list<T>::list(Itr st, Itr ed)
+	list<T, Alloc>::list(Itr st, Itr ed)
 	{
 		assign(st, ed);
 	}
 
-	template <class T>
-	list<T>::list(const list<T>& obj)
+	template <class T, Allocator Alloc>
+	list<T, Alloc>::list(const list<T, Alloc>& obj)
+	    : alloc(obj.alloc)
 	{
-		if (!empty()) this->operator=(obj);
+		if (!obj.empty()) this->operator=(obj);
 	}
 
-	template <class T>
-	list<T>::list(const std::initializer_list<T>& ilist)
+	template <class T, Allocator Alloc>
+	list<T, Alloc>::list(const std::initializer_list<T>& ilist)
 	{
 		for (const auto& x: ilist) push_back(x);
 	}
 
-	template <class T>
-	list<T>& list<T>::operator=(const list<T>& obj)
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::operator=(const list<T, Alloc>& obj)
 	{
 		if (!empty()) clear();
 		assign(obj.begin(), obj.end());
 		return *this;
 	}
 
-	template <class T>
-	list<T>& list<T>::erase(node_ptr start_node, u64 N_far)
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::erase(node_ptr start_node, u64 N_far)
 	{
 		assert(N_far < size() && !empty());
 		i64 i = 0;
@@ -258,13 +350,13 @@ namespace nuts
 					{
 						p->next->prev = nullptr;
 						head = p->next;
-						delete p;
+						alloc_delete(alloc, p);
 						length--;
 						return *this;
 					}
 					else
 					{
-						delete p;
+						alloc_delete(alloc, p);
 						head = tail = nullptr;
 						length--;
 						return *this;
@@ -276,13 +368,13 @@ namespace nuts
 					{
 						p->prev->next = nullptr;
 						tail = p->prev;
-						delete p;
+						alloc_delete(alloc, p);
 						length--;
 						return *this;
 					}
 					else
 					{
-						delete p;
+						alloc_delete(alloc, p);
 						head = tail = nullptr;
 						length--;
 						return *this;
@@ -290,7 +382,7 @@ namespace nuts
 				}
 				p->next->prev = p->prev;
 				p->prev->next = p->next;
-				delete p;
+				alloc_delete(alloc, p);
 				length--;
 				return *this;
 			}
@@ -299,9 +391,9 @@ namespace nuts
 		return *this;
 	}
 
-	template <class T>
+	template <class T, Allocator Alloc>
 	template <typename Func>
-	void list<T>::erase_all(const Func& fn)
+	void list<T, Alloc>::erase_all(const Func& fn)
 	{
 		iterator safe;
 		auto ed = end() + 1;
@@ -318,198 +410,99 @@ namespace nuts
 		}
 	}
 
-	template <class T>
-	list<T>& list<T>::clear()
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::clear()
 	{
 		if (!empty())
 			while (!empty()) pop_back();
 		return *this;
 	}
 
-	template <class T>
-	list<T>& list<T>::emplace_back()
-	{
-		if (!empty())
-		{
-			auto p = tail;
-			p->next = new node;
-			p->next->prev = p;
-			p = p->next;
-			p->next = nullptr;
-			tail = p;
-			length++;
-			return *this;
-		}
-		else// If it's an empty list,add a node.
-		{
-			auto p = new node;
-			p->prev = p->next = nullptr;
-			head = p;
-			tail = p;
-			length++;
-			return *this;
-		}
-	}
-
-	template <class T>
-	list<T>& list<T>::emplace_back(const T& val)
+	// Only frees chunks that have no live node left, in any list
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::shrink()
 	{
-		if (!empty())
-		{
-			auto p = tail;
-			p->next = new node(val);
-			p->next->prev = p;
-			p = p->next;
-			p->next = nullptr;
-			tail = p;
-			length++;
-			return *this;
-		}
-		else// If it's an empty list,add a node.
-		{
-			auto p = new node(val);
-			p->prev = p->next = nullptr;
-			head = p;
-			tail = p;
-			length++;
-			return *this;
-		}
+		if constexpr (requires { node_allocator::shrink(); })
+			node_allocator::shrink();
+		return *this;
 	}
 
-	template <class T>
-	list<T>& list<T>::emplace_back(T&& val)
+	template <class T, Allocator Alloc>
+	template <typename... Args>
+	list<T, Alloc>& list<T, Alloc>::emplace_back(Args&&... args)
 	{
+		auto p = alloc_new(alloc, in_place, static_cast<Args&&>(args)...);
+		p->prev = tail;
 		if (!empty())
-		{
-			auto p = tail;
-			p->next = new node(nuts::move(val));
-			p->next->prev = p;
-			p = p->next;
-			p->next = nullptr;
-			tail = p;
-			length++;
-			return *this;
-		}
+			tail->next = p;
 		else// If it's an empty list,add a node.
-		{
-			auto p = new node(nuts::move(val));
-			p->prev = p->next = nullptr;
 			head = p;
-			tail = p;
-			length++;
-			return *this;
-		}
+		tail = p;
+		length++;
+		return *this;
 	}
 
-	template <class T>
-	list<T>& list<T>::push_back(const T& obj, u64 num)
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::push_back(const T& obj, u64 num)
 	{
 		for (auto i: range(0, num))
 			emplace_back(obj);
 		return *this;
 	}
 
-	template <class T>
-	list<T>& list<T>::push_back(T&& obj)
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::push_back(T&& obj)
 	{
 		emplace_back(nuts::move(obj));
 		return *this;
 	}
 
-	template <class T>
-	list<T>& list<T>::emplace_front()
-	{
-		if (!empty())
-		{
-			auto tmp = head;
-			head = new node;
-			head->next = tmp;
-			tmp->prev = head;
-			length++;
-			return *this;
-		}
-		else
-		{
-			head = new node;
-			tail = head;
-			length++;
-			return *this;
-		}
-	}
-
-	template <class T>
-	list<T>& list<T>::emplace_front(const T& val)
-	{
-		if (!empty())
-		{
-			auto tmp = head;
-			head = new node(val);
-			head->next = tmp;
-			tmp->prev = head;
-			length++;
-			return *this;
-		}
-		else
-		{
-			head = new node(val);
-			tail = head;
-			length++;
-			return *this;
-		}
-	}
-
-	template <class T>
-	list<T>& list<T>::emplace_front(T&& val)
+	template <class T, Allocator Alloc>
+	template <typename... Args>
+	list<T, Alloc>& list<T, Alloc>::emplace_front(Args&&... args)
 	{
+		auto p = alloc_new(alloc, in_place, static_cast<Args&&>(args)...);
+		p->next = head;
 		if (!empty())
-		{
-			auto tmp = head;
-			head = new node(nuts::move(val));
-			head->next = tmp;
-			tmp->prev = head;
-			length++;
-			return *this;
-		}
+			head->prev = p;
 		else
-		{
-			head = new node(nuts::move(val));
-			tail = head;
-			length++;
-			return *this;
-		}
+			tail = p;
+		head = p;
+		length++;
+		return *this;
 	}
 
-	template <class T>
-	list<T>& list<T>::push_front(const T& obj, u64 num)
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::push_front(const T& obj, u64 num)
 	{
 		for (auto i: range(0, num))
 			emplace_front(obj);
 		return *this;
 	}
 
-	template <class T>
-	list<T>& list<T>::push_front(T&& obj)
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::push_front(T&& obj)
 	{
 		emplace_front(nuts::move(obj));
 		return *this;
 	}
 
-	template <class T>
-	list<T>& list<T>::pop_back()
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::pop_back()
 	{
 		erase(tail);
 		return *this;
 	}
 
-	template <class T>
-	list<T>& list<T>::pop_front()
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::pop_front()
 	{
 		erase(head);
 		return *this;
 	}
 
-	template <class T>
-	list<T>& list<T>::merge(list<T>& after)
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::merge(list<T, Alloc>& after)
 	{
 		if (!after.empty())
 		{
@@ -539,11 +532,87 @@ namespace nuts
 		}
 	}
 
-	template <class T>
-	list<T>& list<T>::move(list<T>& src)
+	template <class T, Allocator Alloc>
+	template <class Compare>
+	typename list<T, Alloc>::node_ptr
+	list<T, Alloc>::merge_runs(node_ptr a, node_ptr b, Compare& cmp)
+	{
+		node_ptr res = nullptr;
+		node_ptr* link = &res;
+		while (a != nullptr && b != nullptr)
+		{
+			if (cmp(b->data, a->data))
+				*link = b, b = b->next;
+			else
+				*link = a, a = a->next;
+			link = &(*link)->next;
+		}
+		*link = a != nullptr ? a : b;
+		return res;
+	}
+
+	template <class T, Allocator Alloc>
+	void list<T, Alloc>::rethread(node_ptr first)
+	{
+		head = first;
+		node_ptr prv = nullptr;
+		for (node_ptr p = first; p != nullptr; prv = p, p = p->next)
+			p->prev = prv;
+		tail = prv;
+	}
+
+	template <class T, Allocator Alloc>
+	template <class Compare>
+	list<T, Alloc>& list<T, Alloc>::merge(list<T, Alloc>& after, Compare cmp)
+	{
+		if (&after == this || after.empty()) return *this;
+		rethread(merge_runs(head, after.head, cmp));
+		length += after.length;
+		after.head = after.tail = nullptr;
+		after.length = 0;
+		return *this;
+	}
+
+	// bins[i] holds a sorted run of 2^i nodes, older than any later run,
+	// so 64 pointers are all the extra memory and equal elements keep their order
+	template <class T, Allocator Alloc>
+	template <class Compare>
+	list<T, Alloc>& list<T, Alloc>::sort(Compare cmp)
+	{
+		if (length < 2) return *this;
+
+		node_ptr bins[64] = {};
+		u64 used = 0;
+		for (node_ptr p = head; p != nullptr;)
+		{
+			node_ptr run = p;
+			p = p->next;
+			run->next = nullptr;
+
+			u64 i = 0;
+			for (; i < used && bins[i] != nullptr; ++i)
+			{
+				run = merge_runs(bins[i], run, cmp);
+				bins[i] = nullptr;
+			}
+			if (i == used) ++used;
+			bins[i] = run;
+		}
+
+		node_ptr res = nullptr;
+		for (u64 i = 0; i < used; ++i)
+			if (bins[i] != nullptr)
+				res = res == nullptr ? bins[i] : merge_runs(bins[i], res, cmp);
+		rethread(res);
+		return *this;
+	}
+
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::move(list<T, Alloc>& src)
 	{
 		if (!empty()) clear();
 
+		alloc = src.alloc;
 		length = src.length;
 		head = src.head;
 		tail = src.tail;
@@ -553,8 +622,113 @@ namespace nuts
 		return *this;
 	}
 
-	template <class T>
-	list<T>& list<T>::insert(node_ptr position, const T& obj, u64 num)
+	template <class T, Allocator Alloc>
+	void list<T, Alloc>::link_range(node_ptr pos, node_ptr first, node_ptr last, u64 n)
+	{
+		node_ptr nxt = pos != nullptr ? pos->next : head;
+		first->prev = pos;
+		last->next = nxt;
+		if (pos != nullptr)
+			pos->next = first;
+		else
+			head = first;
+		if (nxt != nullptr)
+			nxt->prev = last;
+		else
+			tail = last;
+		length += n;
+	}
+
+	template <class T, Allocator Alloc>
+	void list<T, Alloc>::unlink_range(node_ptr first, node_ptr last, u64 n)
+	{
+		if (first->prev != nullptr)
+			first->prev->next = last->next;
+		else
+			head = last->next;
+		if (last->next != nullptr)
+			last->next->prev = first->prev;
+		else
+			tail = first->prev;
+		first->prev = last->next = nullptr;
+		length -= n;
+	}
+
+	template <class T, Allocator Alloc>
+	typename list<T, Alloc>::node_ptr list<T, Alloc>::unlink(node_ptr p)
+	{
+		unlink_range(p, p, 1);
+		return p;
+	}
+
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::link_back(node_ptr p)
+	{
+		link_range(tail, p, p, 1);
+		return *this;
+	}
+
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::splice(const iterator& pos, list<T, Alloc>& other)
+	{
+		if (&other == this || other.empty()) return *this;
+		link_range(pos.get(), other.head, other.tail, other.length);
+		other.head = other.tail = nullptr;
+		other.length = 0;
+		return *this;
+	}
+
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::splice(const iterator& pos, list<T, Alloc>& other,
+	                                       const iterator& first, const iterator& last)
+	{
+		u64 n = 0;
+		if (&other != this)// Within one list the length doesn't change
+			for (node_ptr p = first.get();; p = p->next)
+			{
+				++n;
+				if (p == last.get()) break;
+			}
+		return splice(pos, other, first, last, n);
+	}
+
+	// pos must not be inside first..last when other is this list
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::splice(const iterator& pos, list<T, Alloc>& other,
+	                                       const iterator& first, const iterator& last, u64 n)
+	{
+		if (first == npos || pos == last || (pos != npos && pos.get()->next == first.get()))
+			return *this;// Nothing to move, or already in place
+		other.unlink_range(first.get(), last.get(), n);
+		link_range(pos.get(), first.get(), last.get(), n);
+		return *this;
+	}
+
+	template <class T, Allocator Alloc>
+	typename list<T, Alloc>::node_handle list<T, Alloc>::extract(const iterator& pos)
+	{
+		return node_handle(unlink(pos.get()), alloc);
+	}
+
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::insert(node_handle&& nh)
+	{
+		return insert(end(), nuts::move(nh));
+	}
+
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::insert(const iterator& pos, node_handle&& nh)
+	{
+		if (!nh.empty())
+		{
+			node_ptr p = nh.release();
+			link_range(pos.get(), p, p, 1);
+		}
+		return *this;
+	}
+
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::insert(node_ptr position, const T& obj, u64 num)
 	{
 		for (auto p = head; p != nullptr; p = p->next)
 		{
@@ -563,7 +737,7 @@ namespace nuts
 				auto temp = p->next;
 				for (int i = 0; i < num; i++)
 				{
-					p->next = new node(obj);
+					p->next = alloc_new(alloc, obj);
 					p->next->prev = p;
 					p = p->next;
 					p->next = nullptr;
@@ -579,36 +753,36 @@ namespace nuts
 		return *this;
 	}
 
-	template <class T>
-	list<T>& list<T>::insert(const iterator& pos, const T& obj, u64 num)
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::insert(const iterator& pos, const T& obj, u64 num)
 	{
 		insert(pos.get(), obj, num);
 		return *this;
 	}
 
-	template <class T>
-	list<T>& list<T>::erase(iterator pos, u64 N)
+	template <class T, Allocator Alloc>
+	list<T, Alloc>& list<T, Alloc>::erase(iterator pos, u64 N)
 	{
 		return erase(pos.get(), N);
 	}
 
-	template <class T>
+	template <class T, Allocator Alloc>
 	template <typename Func>
-	typename list<T>::iterator
-	list<T>::find(Func fn) const
+	typename list<T, Alloc>::iterator
+	list<T, Alloc>::find(Func fn) const
 	{
 		return nuts::find_if(begin(), end(), fn);
 	}
 
-	template <class T>
+	template <class T, Allocator Alloc>
 	template <Forward_Itr Itr>
-	void list<T>::assign(Itr st, Itr ed)
+	void list<T, Alloc>::assign(Itr st, Itr ed)
 	{
 		for_each(st, ed, [&](const auto& x) { push_back(x); });
 	}
 
-	template <class T>
-	void list<T>::print() const
+	template <class T, Allocator Alloc>
+	void list<T, Alloc>::print() const
 	{
 		auto print = [&](const auto& x) {
 			nuts::print(x);
@@ -19,21 +19,22 @@ namespace nuts
 	};
 
 	template <typename K,
-	          typename V, class Compare = default_key_compare<K, V>>
-	class map : public set<pair<K, V>, Compare>
+	          typename V, class Compare = default_key_compare<K, V>,
+	          Allocator Alloc = allocator<pair<K, V>>>
+	class map : public set<pair<K, V>, Compare, Alloc>
 	{
 	public:
 		using value_type = pair<K, V>;
 		using key_type = K;
 		using val_type = V;
-		using itr_type = typename AVL<pair<K, V>, Compare>::iterator;
-		using base_type = set<pair<K, V>, Compare>;
+		using itr_type = typename AVL<pair<K, V>, Compare, Alloc>::iterator;
+		using base_type = set<pair<K, V>, Compare, Alloc>;
 
 	public:
 		map() = default;
-		map(map<K, V, Compare>&& src) { base_type::move(src); }
+		map(map<K, V, Compare, Alloc>&& src) { base_type::move(src); }
 
-		map(const map<K, V, Compare>& src)
+		map(const map<K, V, Compare, Alloc>& src)
 		{
 			for_each(src, [&](const auto& x) { insert(x); });
 		}
@@ -45,8 +46,8 @@ namespace nuts
 
 		~map() = default;
 
-		map<K, V, Compare>& operator=(const map<K, V, Compare>& src);
-		map<K, V, Compare>& operator=(map<K, V, Compare>&& src)
+		map<K, V, Compare, Alloc>& operator=(const map<K, V, Compare, Alloc>& src);
+		map<K, V, Compare, Alloc>& operator=(map<K, V, Compare, Alloc>&& src)
 		{
 			base_type::move(src);
 			return *this;
@@ -121,17 +122,17 @@ namespace nuts
 	template <class K, class V>
 	map(const std::initializer_list<pair<K, V>>&) -> map<K, V>;
 
-	template <typename K, typename V, class Compare>
-	map<K, V, Compare>& map<K, V, Compare>::
-	operator=(const map<K, V, Compare>& src)
+	template <typename K, typename V, class Compare, Allocator Alloc>
+	map<K, V, Compare, Alloc>& map<K, V, Compare, Alloc>::
+	operator=(const map<K, V, Compare, Alloc>& src)
 	{
 		base_type::clear();
 		for_each(*this, [&](const auto& x) { insert(x); });
 		return *this;
 	}
 
-	template <typename K, typename V, class Compare>
-	void map<K, V, Compare>::print() const
+	template <typename K, typename V, class Compare, Allocator Alloc>
+	void map<K, V, Compare, Alloc>::print() const
 	{
 		auto p = [&](const auto& x) {
 			nuts::print(x);
@@ -44,14 +44,6 @@ namespace nuts
 			return raw[_r][_c];
 		}
 
-		template <typename RetType>
-		friend matrix<RetType, R, C> operator+(const matrix<RetType, R, C>& A,
-		                                       const matrix<RetType, R, C>& B);
-
-		template <typename RetType>
-		friend matrix<RetType, R, C> operator-(const matrix<RetType, R, C>& A,
-		                                       const matrix<RetType, R, C>& B);
-
 		template <typename RetType, u64 R1, u64 C1, u64 C2>
 		friend matrix<RetType, R1, C2> operator*(const matrix<RetType, R1, C1>& A,
 		                                         const matrix<RetType, C1, C2>& B);
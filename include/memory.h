@@ -3,6 +3,12 @@
 
 #include <cassert>
 #include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "concept.h"
+#include "move.h"
 #include "type.h"
 
 namespace nuts
@@ -103,7 +109,7 @@ namespace nuts
 			return *this;
 		}
 
-		unique_ptr<T>& move(unique_ptr<T, Dx>& src) noexcept
+		unique_ptr<T, Dx>& move(unique_ptr<T, Dx>& src) noexcept
 		{
 			_ptr = src._ptr;
 			src._ptr = nullptr;
@@ -354,6 +360,198 @@ namespace nuts
 		return {new T(pac...)};
 	}
 
+	/* Raw storage && relocation */
+
+	// Specialize it for types that survive being moved by a plain memcpy
+	template <typename T>
+	struct is_trivially_relocatable
+	{
+		static constexpr bool value = __is_trivially_copyable(T);
+	};
+
+	template <typename T>
+	constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+	template <typename T>
+	constexpr bool is_trivially_copyable_v = __is_trivially_copyable(T);
+
+	template <typename T>
+	constexpr bool is_trivially_destructible_v = __has_trivial_destructor(T);
+
+	// Storage of these types comes from malloc() so that it can grow by realloc()
+	template <typename T>
+	constexpr bool use_realloc_v = is_trivially_relocatable_v<T> &&
+	                               alignof(T) <= alignof(std::max_align_t);
+
+	template <typename T>
+	inline T* allocate_raw(u64 n)
+	// Uninitialized storage for n objects
+	{
+		if constexpr (use_realloc_v<T>) {
+			auto res = static_cast<T*>(malloc(sizeof(T) * n));
+			assert(res != nullptr || n == 0);
+			return res;
+		}
+		else
+			return static_cast<T*>(::operator new(sizeof(T) * n,
+			                                      std::align_val_t {alignof(T)}));
+	}
+
+	template <typename T>
+	inline T* try_allocate_raw(u64 n) noexcept
+	// Same as allocate_raw(), but nullptr when memory runs out
+	{
+		if constexpr (use_realloc_v<T>)
+			return static_cast<T*>(malloc(sizeof(T) * n));
+		else
+			return static_cast<T*>(::operator new(sizeof(T) * n,
+			                                      std::align_val_t {alignof(T)},
+			                                      std::nothrow));
+	}
+
+	template <typename T>
+	inline void deallocate_raw(T* p)
+	{
+		if constexpr (use_realloc_v<T>)
+			free(p);
+		else
+			::operator delete(p, std::align_val_t {alignof(T)});
+	}
+
+	template <typename T>
+	inline void destroy_n(T* p, u64 n)
+	{
+		if constexpr (!is_trivially_destructible_v<T>)
+			for (u64 i = 0; i < n; ++i) p[i].~T();
+	}
+
+	template <typename T>
+	inline void uninitialized_copy_n(const T* src, u64 n, T* dst)
+	{
+		if constexpr (is_trivially_copyable_v<T>) {
+			if (n != 0) memcpy(dst, src, sizeof(T) * n);
+		}
+		else
+			for (u64 i = 0; i < n; ++i) (void) *new (dst + i) T(src[i]);
+	}
+
+	template <typename T>
+	inline void uninitialized_fill_n(T* dst, u64 n, const T& val)
+	{
+		for (u64 i = 0; i < n; ++i) (void) *new (dst + i) T(val);
+	}
+
+	template <typename T>
+	inline void relocate_n(T* src, u64 n, T* dst)
+	// Move n objects to uninitialized dst, src is left uninitialized
+	{
+		if constexpr (is_trivially_relocatable_v<T>) {
+			if (n != 0) memcpy(dst, src, sizeof(T) * n);
+		}
+		else {
+			for (u64 i = 0; i < n; ++i) {
+				(void) *new (dst + i) T(nuts::move(src[i]));
+				src[i].~T();
+			}
+		}
+	}
+
+	template <typename T>
+	T* reallocate_raw(T* p, u64 n, u64 new_cap)
+	// Grow or shrink storage holding n live objects
+	{
+		if constexpr (use_realloc_v<T>) {
+			auto res = static_cast<T*>(realloc(p, sizeof(T) * new_cap));
+			assert(res != nullptr || new_cap == 0);
+			return res;
+		}
+		else {
+			T* res = allocate_raw<T>(new_cap);
+			if (p != nullptr) {
+				relocate_n(p, n, res);
+				deallocate_raw(p);
+			}
+			return res;
+		}
+	}
+
+	/* Allocator */
+
+	template <typename A>
+	concept Allocator = requires(A a, typename A::value_type* p, u64 n)
+	{
+		typename A::value_type;
+		typename A::template rebind<typename A::value_type>;
+		{ a.allocate(n) } -> Same<typename A::value_type*>;
+		a.deallocate(p, n);
+	};
+
+	// Optional extension, grow storage of n live objects in place
+	template <typename A>
+	concept Reallocator = Allocator<A> &&
+	        requires(A a, typename A::value_type* p, u64 n)
+	{
+		{ a.reallocate(p, n, n) } -> Same<typename A::value_type*>;
+	};
+
+	// Allocator of the same family for another value type
+	template <Allocator A, typename U>
+	using rebind_alloc = typename A::template rebind<U>;
+
+	template <typename T>
+	struct allocator
+	{
+		using value_type = T;
+
+		template <typename U>
+		using rebind = allocator<U>;
+
+		allocator() = default;
+		template <typename U>
+		allocator(const allocator<U>&) noexcept {}
+
+		inline T* allocate(u64 n) { return allocate_raw<T>(n); }
+		inline void deallocate(T* p, u64) { deallocate_raw(p); }
+		inline T* reallocate(T* p, u64 n, u64 new_cap)
+		{
+			return reallocate_raw(p, n, new_cap);
+		}
+
+		inline bool operator==(const allocator&) const { return true; }
+		inline bool operator!=(const allocator&) const { return false; }
+	};
+
+	template <Allocator A, typename... Args>
+	inline auto alloc_new(A& a, Args&&... args)
+	// Allocate and construct one object
+	{
+		using T = typename A::value_type;
+		T* p = a.allocate(1);
+		return new (p) T(static_cast<Args&&>(args)...);
+	}
+
+	template <Allocator A>
+	inline void alloc_delete(A& a, typename A::value_type* p)
+	// Destroy and release one object
+	{
+		using T = typename A::value_type;
+		if (p == nullptr) return;
+		p->~T();
+		a.deallocate(p, 1);
+	}
+
+	// Stateless deleter that hands nodes back to a default-constructed A
+	template <Allocator A>
+	struct alloc_delete_fn
+	{
+		template <typename Node>
+		inline void operator()(Node* p) const
+		{
+			rebind_alloc<A, Node> a;
+			alloc_delete(a, p);
+		}
+	};
+
 	template <typename T>
 	struct Box
 	{
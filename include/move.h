@@ -16,6 +16,14 @@ namespace nuts
 	{
 		return static_cast<T&&>(x);
 	}
+
+	// Tag for constructors that build their payload from the arguments in place
+	struct in_place_t
+	{
+		explicit in_place_t() = default;
+	};
+
+	inline constexpr in_place_t in_place {};
 }
 
 #endif
\ No newline at end of file
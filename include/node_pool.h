@@ -0,0 +1,288 @@
+#ifndef _NUTS_NODE_POOL_
+#define _NUTS_NODE_POOL_
+
+/** @file node_pool
+     *  node_pool: fixed-size blocks carved from chunks of ChunkN, recycled through free lists
+     *  Each thread allocates from and frees into its own cache without locking,
+     *  caches spill surplus blocks to a shared depot that empty caches refill from,
+     *  so producer/consumer threads reach a steady state without calling malloc
+     *  Chunks are only released by shrink(), once all their blocks are free
+     *  pool_allocator serves single objects from the pool of its size and alignment,
+     *  list (and so deque, queue and the chained hash tables) uses it for the default allocator,
+     *  define NUTS_NO_NODE_POOL to go back to one malloc per node
+     */
+
+#include <mutex>
+
+#include "algorithm.h"
+#include "memory.h"
+#include "type.h"
+
+namespace nuts
+{
+	template <u64 Size, u64 Align, u64 ChunkN>
+	class node_pool
+	{
+		static_assert(ChunkN != 0);
+
+		union block
+		{
+			block* next;
+			alignas(Align) unsigned char data[Size];
+		};
+
+		struct chunk
+		{
+			chunk* next;
+		};
+
+		// Blocks start after the chunk header, at their own alignment
+		static constexpr u64 ALIGN = alignof(block) > alignof(chunk) ? alignof(block) : alignof(chunk);
+		static constexpr u64 OFFSET = (sizeof(chunk) + alignof(block) - 1) / alignof(block) * alignof(block);
+		static constexpr u64 CHUNK_BYTES = OFFSET + ChunkN * sizeof(block);
+
+		struct free_list
+		{
+			block* head = nullptr;
+			u64 count = 0;
+
+			inline void push(block* p)
+			{
+				p->next = head;
+				head = p;
+				++count;
+			}
+
+			inline block* pop()
+			{
+				block* p = head;
+				head = p->next;
+				--count;
+				return p;
+			}
+
+			// Moves up to n blocks to the front of dst
+			void give(free_list& dst, u64 n)
+			{
+				if (n == 0 || head == nullptr) return;
+				block *first = head, *last = head;
+				u64 k = 1;
+				for (; k < n && last->next != nullptr; ++k) last = last->next;
+				head = last->next, count -= k;
+				last->next = dst.head;
+				dst.head = first, dst.count += k;
+			}
+		};
+
+		// Shared by every thread, never destroyed so late frees stay valid
+		struct depot
+		{
+			std::mutex mtx;
+			free_list blocks;
+			chunk* chunks = nullptr;
+			u64 chunk_count = 0;
+		};
+
+		static depot& shared()
+		{
+			static depot* d = new depot;
+			return *d;
+		}
+
+		// Trivially destructible, stays usable by frees after the thread's guard has run
+		static inline thread_local free_list cache;
+
+		// Hands the cache to the depot when the thread exits
+		struct cache_guard
+		{
+			bool armed = false;
+			~cache_guard()
+			{
+				depot& d = shared();
+				std::lock_guard<std::mutex> lk(d.mtx);
+				cache.give(d.blocks, cache.count);
+			}
+		};
+
+		static inline thread_local cache_guard guard;
+
+		static block* first_block(chunk* c)
+		{
+			return reinterpret_cast<block*>(reinterpret_cast<unsigned char*>(c) + OFFSET);
+		}
+
+		static void refill()
+		{
+			guard.armed = true;
+			depot& d = shared();
+			{
+				std::lock_guard<std::mutex> lk(d.mtx);
+				d.blocks.give(cache, ChunkN);
+			}
+			if (cache.count != 0) return;
+
+			auto c = static_cast<chunk*>(::operator new(CHUNK_BYTES, std::align_val_t {ALIGN}));
+			block* b = first_block(c);
+			for (u64 i = ChunkN; i != 0; --i) cache.push(b + i - 1);
+
+			std::lock_guard<std::mutex> lk(d.mtx);
+			c->next = d.chunks;
+			d.chunks = c;
+			++d.chunk_count;
+		}
+
+	public:
+		static constexpr u64 block_size = sizeof(block);
+		static constexpr u64 chunk_bytes = CHUNK_BYTES;
+
+		static void* get()
+		{
+			if (cache.head == nullptr) refill();
+			return cache.pop();
+		}
+
+		static void put(void* p)
+		{
+			if (cache.head == nullptr) guard.armed = true;// Threads that only free need the guard too
+			cache.push(static_cast<block*>(p));
+			if (cache.count >= 2 * ChunkN)
+			{
+				depot& d = shared();
+				std::lock_guard<std::mutex> lk(d.mtx);
+				cache.give(d.blocks, ChunkN);
+			}
+		}
+
+		// Chunks held by the pool, across all threads
+		static u64 chunk_count()
+		{
+			depot& d = shared();
+			std::lock_guard<std::mutex> lk(d.mtx);
+			return d.chunk_count;
+		}
+
+		// Frees the chunks whose blocks all sit in the depot or this thread's cache,
+		// returns the bytes released, blocks cached by other threads keep their chunks alive
+		static u64 shrink();
+	};
+
+	template <u64 Size, u64 Align, u64 ChunkN>
+	u64 node_pool<Size, Align, ChunkN>::shrink()
+	{
+		depot& d = shared();
+		std::lock_guard<std::mutex> lk(d.mtx);
+		if (d.chunks == nullptr || cache.count + d.blocks.count < ChunkN) return 0;
+		d.blocks.give(cache, d.blocks.count);
+
+		// Chunks by address, with the number of their free blocks
+		const u64 n = d.chunk_count;
+		chunk** arr = allocate_raw<chunk*>(n);
+		u64* cnt = allocate_raw<u64>(n);
+		u64 k = 0;
+		for (chunk* c = d.chunks; c != nullptr; c = c->next) arr[k++] = c;
+		nuts::sort(arr, arr + n - 1);
+		for (u64 i = 0; i < n; ++i) cnt[i] = 0;
+
+		auto owner = [&](block* p) {
+			u64 lo = 0, hi = n;// Last chunk starting at or below p
+			while (hi - lo > 1)
+			{
+				u64 mid = (lo + hi) / 2;
+				if (reinterpret_cast<unsigned char*>(arr[mid]) <= reinterpret_cast<unsigned char*>(p))
+					lo = mid;
+				else
+					hi = mid;
+			}
+			return lo;
+		};
+
+		for (block* p = cache.head; p != nullptr; p = p->next) ++cnt[owner(p)];
+
+		// Blocks of surviving chunks go back to the depot for every thread, the rest are freed
+		free_list kept;
+		for (block* p = cache.head; p != nullptr;)
+		{
+			block* nxt = p->next;
+			if (cnt[owner(p)] != ChunkN) kept.push(p);
+			p = nxt;
+		}
+		d.blocks = kept;
+		cache = free_list {};
+
+		u64 res = 0;
+		d.chunks = nullptr;
+		d.chunk_count = 0;
+		for (u64 i = 0; i < n; ++i)
+		{
+			if (cnt[i] == ChunkN)
+			{
+				::operator delete(arr[i], std::align_val_t {ALIGN});
+				res += CHUNK_BYTES;
+			}
+			else
+			{
+				arr[i]->next = d.chunks;
+				d.chunks = arr[i];
+				++d.chunk_count;
+			}
+		}
+		deallocate_raw(arr);
+		deallocate_raw(cnt);
+		return res;
+	}
+
+	// Single objects come from the node_pool of sizeof(T), arrays from allocate_raw()
+	template <typename T, u64 ChunkN = 64>
+	struct pool_allocator
+	{
+		using value_type = T;
+		using pool_type = node_pool<sizeof(T), alignof(T), ChunkN>;
+
+		template <typename U>
+		using rebind = pool_allocator<U, ChunkN>;
+
+		pool_allocator() = default;
+		template <typename U>
+		pool_allocator(const pool_allocator<U, ChunkN>&) noexcept {}
+		template <typename U>
+		pool_allocator(const allocator<U>&) noexcept {}
+
+		inline T* allocate(u64 n)
+		{
+			return n == 1 ? static_cast<T*>(pool_type::get()) : allocate_raw<T>(n);
+		}
+
+		inline void deallocate(T* p, u64 n)
+		{
+			if (n == 1)
+				pool_type::put(p);
+			else
+				deallocate_raw(p);
+		}
+
+		static u64 shrink() { return pool_type::shrink(); }
+
+		inline bool operator==(const pool_allocator&) const { return true; }
+		inline bool operator!=(const pool_allocator&) const { return false; }
+	};
+
+	// Allocator a node-based container uses for Alloc, the default allocator is pooled
+	template <Allocator A, typename Node>
+	struct node_alloc_of
+	{
+		using type = rebind_alloc<A, Node>;
+	};
+
+#ifndef NUTS_NO_NODE_POOL
+	template <typename U, typename Node>
+	struct node_alloc_of<allocator<U>, Node>
+	{
+		using type = pool_allocator<Node>;
+	};
+#endif
+
+	template <Allocator A, typename Node>
+	using node_alloc_t = typename node_alloc_of<A, Node>::type;
+}
+
+#endif
@@ -0,0 +1,281 @@
+#ifndef _NUTS_PARALLEL_
+#define _NUTS_PARALLEL_
+
+/** @file parallel
+     *  thread_pool: fixed workers draining one task queue
+     *  task_group: fork-join on a pool, wait() helps instead of blocking
+     *  parallel_sort: sort P chunks at once, then merge pairs in parallel
+     */
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#include "algorithm.h"
+#include "list.h"
+#include "memory.h"
+#include "queue.h"
+#include "type.h"
+#include "vector.h"
+
+#ifndef PARALLEL_CUTOFF
+#define PARALLEL_CUTOFF (1ULL << 16)// Below this, parallel_sort() is sort()
+#endif
+
+namespace nuts
+{
+	class thread_pool
+	{
+	public:
+		using task_type = std::function<void()>;
+
+		explicit thread_pool(u64 n = std::thread::hardware_concurrency());
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+		~thread_pool();
+
+		// One pool per process, sized to the hardware
+		static thread_pool& global();
+
+		inline u64 size() const noexcept { return workers.size(); }
+
+		template <class Fn>
+		void submit(Fn&& fn);
+
+		bool run_one();// Run one queued task on the caller, false if none
+
+	protected:
+		vector<std::thread> workers;
+		queue<task_type, list<task_type>> tasks;
+		std::mutex mtx;
+		std::condition_variable cv;
+		bool stop = false;
+	};
+
+	inline thread_pool::thread_pool(u64 n)
+	{
+		if (n == 0) n = 1;
+		workers.reserve(n);
+		for (u64 i = 0; i < n; ++i) {
+			workers.emplace_back(std::thread {[this] {
+				for (;;) {
+					task_type task;
+					{
+						std::unique_lock lk {mtx};
+						cv.wait(lk, [this] { return stop || !tasks.empty(); });
+						if (stop && tasks.empty()) return;
+						task = nuts::move(tasks.front());
+						tasks.pop();
+					}
+					task();
+				}
+			}});
+		}
+	}
+
+	inline thread_pool::~thread_pool()
+	{
+		{
+			std::lock_guard lk {mtx};
+			stop = true;
+		}
+		cv.notify_all();
+		for (u64 i = 0; i < workers.size(); ++i)
+			workers[i].join();
+	}
+
+	inline thread_pool& thread_pool::global()
+	{
+		static thread_pool pool;
+		return pool;
+	}
+
+	template <class Fn>
+	void thread_pool::submit(Fn&& fn)
+	{
+		{
+			std::lock_guard lk {mtx};
+			tasks.push(task_type {std::forward<Fn>(fn)});
+		}
+		cv.notify_one();
+	}
+
+	inline bool thread_pool::run_one()
+	{
+		task_type task;
+		{
+			std::lock_guard lk {mtx};
+			if (tasks.empty()) return false;
+			task = nuts::move(tasks.front());
+			tasks.pop();
+		}
+		task();
+		return true;
+	}
+
+	class task_group
+	{
+	public:
+		explicit task_group(thread_pool& p = thread_pool::global()) : pool(p) {}
+		~task_group() { wait(); }
+
+		template <class Fn>
+		void run(Fn&& fn)
+		{
+			pending.fetch_add(1, std::memory_order_relaxed);
+			pool.submit([this, fn = std::forward<Fn>(fn)]() mutable {
+				fn();
+				pending.fetch_sub(1, std::memory_order_release);
+			});
+		}
+
+		// Nested groups may wait on a worker, so never sleep while tasks are queued
+		void wait()
+		{
+			while (pending.load(std::memory_order_acquire) != 0)
+				if (!pool.run_one())
+					std::this_thread::yield();
+		}
+
+	protected:
+		thread_pool& pool;
+		std::atomic<u64> pending {0};
+	};
+
+	namespace detail
+	{
+		// How many of the first d merged elements come from a, ties go to a
+		template <class A, class B, class Compare>
+		u64 co_rank(u64 d, A a, u64 na, B b, u64 nb, Compare& cmp)
+		{
+			u64 lo = d > nb ? d - nb : 0,
+			    hi = d < na ? d : na;
+			while (lo < hi) {
+				u64 i = lo + (hi - lo) / 2;
+				if (!cmp(b[d - i - 1], a[i]))
+					lo = i + 1;
+				else
+					hi = i;
+			}
+			return lo;
+		}
+
+		// Construct: dst is raw memory, otherwise it holds live elements
+		template <bool Construct, class Src, class Dst, class Compare>
+		void merge_move(Src a, u64 na, Src b, u64 nb, Dst out, Compare& cmp)
+		{
+			using T = typename deref<Dst>::type;
+			const auto put = [&](auto& x) {
+				if constexpr (Construct)
+					(void) *new (&*out) T(nuts::move(x));
+				else
+					*out = nuts::move(x);
+				++out;
+			};
+
+			u64 i = 0, j = 0;
+			while (i < na && j < nb) {
+				if (cmp(b[j], a[i]))
+					put(b[j++]);
+				else
+					put(a[i++]);
+			}
+			while (i < na) put(a[i++]);
+			while (j < nb) put(b[j++]);
+		}
+
+		// Merge every adjacent pair of runs from src into dst, one round
+		template <bool Construct, class Src, class Dst, class Compare>
+		void merge_round(Src src, Dst dst, const vector<u64>& runs,
+		                 u64 grain, Compare& cmp, thread_pool& pool)
+		{
+			task_group g {pool};
+			for (u64 k = 0; k + 1 < runs.size(); k += 2) {
+				const u64 st = runs[k], mid = runs[k + 1],
+				          ed = k + 2 < runs.size() ? runs[k + 2] : mid;
+				const u64 na = mid - st, nb = ed - mid, n = na + nb;
+				auto a = src + st, b = src + mid;
+
+				for (u64 d = 0; d < n; d += grain) {
+					const u64 e = d + grain < n ? d + grain : n;
+					g.run([=, &cmp] {
+						const u64 i0 = co_rank(d, a, na, b, nb, cmp),
+						          i1 = co_rank(e, a, na, b, nb, cmp);
+						merge_move<Construct>(a + i0, i1 - i0, b + (d - i0),
+						                      (e - i1) - (d - i0), dst + (st + d), cmp);
+					});
+				}
+			}
+			g.wait();
+		}
+	}
+
+	template <Random_Itr Itr, class Compare = less<>>
+	// Average case -> O(nlogn / P + n)
+	void parallel_sort(Itr st, Itr ed, Compare cmp = Compare {},
+	                   thread_pool& pool = thread_pool::global())
+	{
+		using T = deref_t<Itr>;
+		const u64 n = distance(st, ed),
+		          P = pool.size();
+		if (n < PARALLEL_CUTOFF || P < 2)
+			return sort(st, ed, cmp);
+
+		// Runs: [runs[k], runs[k + 1]), one per worker
+		vector<u64> runs;
+		for (u64 k = 0; k < P; ++k)
+			runs.push_back(n * k / P);
+		runs.push_back(n);
+		{
+			task_group g {pool};
+			for (u64 k = 0; k + 1 < runs.size(); ++k)
+				g.run([&, k] { sort(st + runs[k], st + (runs[k + 1] - 1), cmp); });
+		}
+
+		// Ping-pong between the range and a buffer, constructed on first use
+		T* buf = allocate_raw<T>(n);
+		const u64 grain = max(n / (P * 4), (u64) PARALLEL_CUTOFF / 4);
+		bool in_buf = false, buf_live = false;
+
+		while (runs.size() > 2) {
+			if (!in_buf && !buf_live)
+				detail::merge_round<true>(st, buf, runs, grain, cmp, pool);
+			else if (!in_buf)
+				detail::merge_round<false>(st, buf, runs, grain, cmp, pool);
+			else
+				detail::merge_round<false>(buf, st, runs, grain, cmp, pool);
+			buf_live = true, in_buf = !in_buf;
+
+			vector<u64> next;
+			for (u64 k = 0; k < runs.size(); k += 2)
+				next.push_back(runs[k]);
+			if (next.back() != n) next.push_back(n);
+			runs.move(next);
+		}
+
+		if (in_buf) {
+			task_group g {pool};
+			for (u64 d = 0; d < n; d += grain)
+				g.run([&, d] {
+					for (u64 i = d, e = min(d + grain, n); i < e; ++i)
+						st[i] = nuts::move(buf[i]);
+				});
+		}
+		if (buf_live) destroy_n(buf, n);
+		deallocate_raw(buf);
+	}
+
+	template <Container Box, class Compare = less<>>
+	    requires Random_Itr<typename Box::iterator>
+	// Average case -> O(nlogn / P + n)
+	void parallel_sort(Box& box, Compare cmp = Compare {},
+	                   thread_pool& pool = thread_pool::global())
+	{
+		parallel_sort(box.begin(), box.end(), cmp, pool);
+	}
+}
+
+#endif
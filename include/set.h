@@ -5,13 +5,14 @@
 
 namespace nuts
 {
-	template <typename T, class Compare = nuts::less<T>>
-	class set : public AVL<T, Compare>
+	template <typename T, class Compare = nuts::less<T>,
+	          Allocator Alloc = allocator<T>>
+	class set : public AVL<T, Compare, Alloc>
 	{
 	public:
 		using value_type = T;
-		using base_type = AVL<T, Compare>;
-		using self_type = set<T, Compare>;
+		using base_type = AVL<T, Compare, Alloc>;
+		using self_type = set<T, Compare, Alloc>;
 
 	public:
 		set() { this->root = nullptr, this->_size = 0; }
@@ -30,41 +31,41 @@ namespace nuts
 	template <class K>
 	set(const std::initializer_list<K>&) -> set<K>;
 
-	template <typename T, class Compare>
-	set<T, Compare>& set<T, Compare>::operator=(self_type&& src)
+	template <typename T, class Compare, Allocator Alloc>
+	set<T, Compare, Alloc>& set<T, Compare, Alloc>::operator=(self_type&& src)
 	{
 		return move(src);
 	}
 
-	template <typename T, class Compare>
-	set<T, Compare>& set<T, Compare>::move(self_type& src)
+	template <typename T, class Compare, Allocator Alloc>
+	set<T, Compare, Alloc>& set<T, Compare, Alloc>::move(self_type& src)
 	{
 		base_type::move(src);
 		return *this;
 	}
 
-	template <typename T, class Compare>
-	set<T, Compare>::set(const std::initializer_list<T>& ilist)
+	template <typename T, class Compare, Allocator Alloc>
+	set<T, Compare, Alloc>::set(const std::initializer_list<T>& ilist)
 	{
 		for (const auto& x: ilist) base_type::insert(x);
 	}
 
-	template <typename T, class Compare>
-	set<T, Compare>::set(const self_type& src)
+	template <typename T, class Compare, Allocator Alloc>
+	set<T, Compare, Alloc>::set(const self_type& src)
 	{
 		for_each(src, [&](const T& x) { base_type::insert(x); });
 	}
 
-	template <typename T, class Compare>
-	set<T, Compare>& set<T, Compare>::operator=(const self_type& src)
+	template <typename T, class Compare, Allocator Alloc>
+	set<T, Compare, Alloc>& set<T, Compare, Alloc>::operator=(const self_type& src)
 	{
 		base_type::clear();
 		for_each(src, [&](const T& x) { base_type::insert(x); });
 		return *this;
 	}
 
-	template <typename T, class Compare>
-	void set<T, Compare>::print() const
+	template <typename T, class Compare, Allocator Alloc>
+	void set<T, Compare, Alloc>::print() const
 	{
 		auto p = [&](const auto& x) {
 			nuts::print(x);
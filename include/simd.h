@@ -0,0 +1,510 @@
+#ifndef _NUTS_SIMD_
+#define _NUTS_SIMD_
+
+/** @file simd
+     *  Vector kernels behind find, fill_n, min_in, max_in, is_sorted and reverse
+     *  Used when the range is a raw pointer to an arithmetic type
+     *  SSE2 and AVX2 builds live side by side, the CPU picks one at runtime
+     *  Define NUTS_NO_SIMD to keep the generic loops of algorithm.h
+     */
+
+#include <type_traits>
+
+#include "type.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+        (defined(__GNUC__) || defined(__clang__)) && !defined(NUTS_NO_SIMD)
+#include <immintrin.h>
+#define NUTS_SIMD_X86 1
+#define NUTS_TARGET_SSE2 __attribute__((target("sse2")))
+#define NUTS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace nuts::simd
+{
+	// Element types handled by the kernels, bool stays generic
+	template <typename T>
+	concept Lane = std::is_arithmetic_v<T> && !std::is_same_v<T, bool> &&
+	               (sizeof(T) == 1 || sizeof(T) == 2 ||
+	                sizeof(T) == 4 || sizeof(T) == 8);
+
+	// Kernels only compare integers by order, IEEE NaN breaks min/max/sorted
+	template <typename T>
+	concept Ordered_Lane = Lane<T> && std::is_integral_v<T>;
+
+	// Element-at-a-time fallback, every kernel keeps this exact semantics
+	struct scalar
+	{
+		template <Lane T>
+		static u64 find(const T* p, u64 n, T v)
+		{
+			u64 i = 0;
+			while (i < n && !(p[i] == v)) ++i;
+			return i;
+		}
+
+		template <Lane T>
+		static void fill(T* p, u64 n, T v)
+		{
+			for (u64 i = 0; i < n; ++i) p[i] = v;
+		}
+
+		template <bool Max, Lane T>
+		static u64 extreme(const T* p, u64 n)
+		{
+			u64 at = 0;
+			for (u64 i = 1; i < n; ++i)
+				if (Max ? p[i] > p[at] : p[i] < p[at])
+					at = i;
+			return at;
+		}
+
+		template <bool Desc, Lane T>
+		static bool sorted(const T* p, u64 n)
+		{
+			for (u64 i = 1; i < n; ++i)
+				if (Desc ? p[i] > p[i - 1] : p[i] < p[i - 1])
+					return false;
+			return true;
+		}
+
+		template <Lane T>
+		static void reverse(T* p, u64 n)
+		{
+			for (u64 lo = 0, hi = n; hi - lo >= 2; ++lo)
+			{
+				T tmp = p[lo];
+				p[lo] = p[--hi], p[hi] = tmp;
+			}
+		}
+	};
+
+#ifdef NUTS_SIMD_X86
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+// Kernels pass AVX registers around, but only ever inlined into on_avx2()
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+	// Raw pointer over Lane elements, what vector/array/basic_string hand out
+	template <typename Itr>
+	concept Contiguous = std::is_pointer_v<Itr> &&
+	                     Lane<std::remove_cv_t<std::remove_pointer_t<Itr>>>;
+
+	enum class level : u8
+	{
+		SCALAR,
+		SSE2,
+		AVX2,
+	};
+
+	inline level detect() noexcept
+	{
+#if defined(__AVX2__)
+		return level::AVX2;
+#else
+		static const level lv = [] {
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2")) return level::AVX2;
+			if (__builtin_cpu_supports("sse2")) return level::SSE2;
+			return level::SCALAR;
+		}();
+		return lv;
+#endif
+	}
+
+	struct sse2
+	{
+		using reg = __m128i;
+		static constexpr u64 width = 16;
+
+		NUTS_TARGET_SSE2 static inline reg load(const void* p)
+		{
+			return _mm_loadu_si128(static_cast<const reg*>(p));
+		}
+
+		NUTS_TARGET_SSE2 static inline void store(void* p, reg x)
+		{
+			_mm_storeu_si128(static_cast<reg*>(p), x);
+		}
+
+		template <Lane T>
+		NUTS_TARGET_SSE2 static inline reg broadcast(T v)
+		{
+			T buf[width / sizeof(T)];
+			for (auto& x: buf) x = v;
+			return load(buf);
+		}
+
+		// One bit per byte, a lane is set when all of its bytes are
+		NUTS_TARGET_SSE2 static inline u32 mask(reg x)
+		{
+			return static_cast<u32>(_mm_movemask_epi8(x));
+		}
+
+		NUTS_TARGET_SSE2 static inline reg bit_or(reg a, reg b)
+		{
+			return _mm_or_si128(a, b);
+		}
+
+		// m ? b : a, lane by lane
+		NUTS_TARGET_SSE2 static inline reg select(reg m, reg a, reg b)
+		{
+			return _mm_or_si128(_mm_and_si128(m, b), _mm_andnot_si128(m, a));
+		}
+
+		template <Lane T>
+		NUTS_TARGET_SSE2 static inline reg eq(reg a, reg b)
+		{
+			if constexpr (std::is_floating_point_v<T> && sizeof(T) == 4)
+				return _mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b)));
+			else if constexpr (std::is_floating_point_v<T>)
+				return _mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b)));
+			else if constexpr (sizeof(T) == 1)
+				return _mm_cmpeq_epi8(a, b);
+			else if constexpr (sizeof(T) == 2)
+				return _mm_cmpeq_epi16(a, b);
+			else if constexpr (sizeof(T) == 4)
+				return _mm_cmpeq_epi32(a, b);
+			else
+			{
+				// No 64-bit compare before SSE4.1, both halves must match
+				reg m = _mm_cmpeq_epi32(a, b);
+				return _mm_and_si128(m, _mm_shuffle_epi32(m, 0xB1));
+			}
+		}
+
+		// No 64-bit signed compare before SSE4.2
+		template <Lane T>
+		static constexpr bool ordered = Ordered_Lane<T> && sizeof(T) <= 4;
+
+		template <Ordered_Lane T>
+		NUTS_TARGET_SSE2 static inline reg gt(reg a, reg b)
+		{
+			if constexpr (std::is_unsigned_v<T>)
+			{
+				// Flip the sign bit, unsigned order becomes signed order
+				const reg s = broadcast<T>(T(1) << (sizeof(T) * 8 - 1));
+				a = _mm_xor_si128(a, s), b = _mm_xor_si128(b, s);
+			}
+			if constexpr (sizeof(T) == 1)
+				return _mm_cmpgt_epi8(a, b);
+			else if constexpr (sizeof(T) == 2)
+				return _mm_cmpgt_epi16(a, b);
+			else
+				return _mm_cmpgt_epi32(a, b);
+		}
+
+		template <Lane T>
+		NUTS_TARGET_SSE2 static inline reg reverse(reg x)
+		{
+			if constexpr (sizeof(T) == 8)
+				return _mm_shuffle_epi32(x, 0x4E);
+			else if constexpr (sizeof(T) == 4)
+				return _mm_shuffle_epi32(x, 0x1B);
+			else
+			{
+				if constexpr (sizeof(T) == 1)
+					x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+				x = _mm_shufflelo_epi16(x, 0x1B);
+				x = _mm_shufflehi_epi16(x, 0x1B);
+				return _mm_shuffle_epi32(x, 0x4E);
+			}
+		}
+	};
+
+	struct avx2
+	{
+		using reg = __m256i;
+		static constexpr u64 width = 32;
+
+		NUTS_TARGET_AVX2 static inline reg load(const void* p)
+		{
+			return _mm256_loadu_si256(static_cast<const reg*>(p));
+		}
+
+		NUTS_TARGET_AVX2 static inline void store(void* p, reg x)
+		{
+			_mm256_storeu_si256(static_cast<reg*>(p), x);
+		}
+
+		template <Lane T>
+		NUTS_TARGET_AVX2 static inline reg broadcast(T v)
+		{
+			T buf[width / sizeof(T)];
+			for (auto& x: buf) x = v;
+			return load(buf);
+		}
+
+		NUTS_TARGET_AVX2 static inline u32 mask(reg x)
+		{
+			return static_cast<u32>(_mm256_movemask_epi8(x));
+		}
+
+		NUTS_TARGET_AVX2 static inline reg bit_or(reg a, reg b)
+		{
+			return _mm256_or_si256(a, b);
+		}
+
+		NUTS_TARGET_AVX2 static inline reg select(reg m, reg a, reg b)
+		{
+			return _mm256_blendv_epi8(a, b, m);
+		}
+
+		template <Lane T>
+		NUTS_TARGET_AVX2 static inline reg eq(reg a, reg b)
+		{
+			if constexpr (std::is_floating_point_v<T> && sizeof(T) == 4)
+				return _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(a),
+				                                         _mm256_castsi256_ps(b), _CMP_EQ_OQ));
+			else if constexpr (std::is_floating_point_v<T>)
+				return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(a),
+				                                         _mm256_castsi256_pd(b), _CMP_EQ_OQ));
+			else if constexpr (sizeof(T) == 1)
+				return _mm256_cmpeq_epi8(a, b);
+			else if constexpr (sizeof(T) == 2)
+				return _mm256_cmpeq_epi16(a, b);
+			else if constexpr (sizeof(T) == 4)
+				return _mm256_cmpeq_epi32(a, b);
+			else
+				return _mm256_cmpeq_epi64(a, b);
+		}
+
+		template <Lane T>
+		static constexpr bool ordered = Ordered_Lane<T>;
+
+		template <Ordered_Lane T>
+		NUTS_TARGET_AVX2 static inline reg gt(reg a, reg b)
+		{
+			if constexpr (std::is_unsigned_v<T>)
+			{
+				const reg s = broadcast<T>(T(1) << (sizeof(T) * 8 - 1));
+				a = _mm256_xor_si256(a, s), b = _mm256_xor_si256(b, s);
+			}
+			if constexpr (sizeof(T) == 1)
+				return _mm256_cmpgt_epi8(a, b);
+			else if constexpr (sizeof(T) == 2)
+				return _mm256_cmpgt_epi16(a, b);
+			else if constexpr (sizeof(T) == 4)
+				return _mm256_cmpgt_epi32(a, b);
+			else
+				return _mm256_cmpgt_epi64(a, b);
+		}
+
+		template <Lane T>
+		NUTS_TARGET_AVX2 static inline reg reverse(reg x)
+		{
+			if constexpr (sizeof(T) == 8)
+				return _mm256_permute4x64_epi64(x, 0x1B);
+			else if constexpr (sizeof(T) == 4)
+				return _mm256_permutevar8x32_epi32(x, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+			else
+			{
+				// Reverse inside each 128-bit half, then swap the halves
+				const reg idx = sizeof(T) == 2
+				                        ? _mm256_setr_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1,
+				                                           14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1)
+				                        : _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+				                                           15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+				return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(x, idx), 0x4E);
+			}
+		}
+	};
+
+	template <class Ops>
+	struct kernel
+	{
+		using reg = typename Ops::reg;
+
+		template <Lane T>
+		static constexpr u64 lanes = Ops::width / sizeof(T);
+
+		template <Lane T>
+		static u64 find(const T* p, u64 n, T v)
+		{
+			constexpr u64 L = lanes<T>;
+			const reg key = Ops::template broadcast<T>(v);
+			u64 i = 0;
+
+			// Four registers per round, locate the exact lane afterwards
+			for (; i + 4 * L <= n; i += 4 * L)
+			{
+				reg a = Ops::template eq<T>(Ops::load(p + i), key);
+				reg b = Ops::template eq<T>(Ops::load(p + i + L), key);
+				reg c = Ops::template eq<T>(Ops::load(p + i + 2 * L), key);
+				reg d = Ops::template eq<T>(Ops::load(p + i + 3 * L), key);
+				if (Ops::mask(Ops::bit_or(Ops::bit_or(a, b), Ops::bit_or(c, d))))
+					break;
+			}
+			for (; i + L <= n; i += L)
+			{
+				u32 m = Ops::mask(Ops::template eq<T>(Ops::load(p + i), key));
+				if (m) return i + __builtin_ctz(m) / sizeof(T);
+			}
+			return i + scalar::find(p + i, n - i, v);
+		}
+
+		template <Lane T>
+		static void fill(T* p, u64 n, T v)
+		{
+			constexpr u64 L = lanes<T>;
+			const reg x = Ops::template broadcast<T>(v);
+			u64 i = 0;
+			for (; i + L <= n; i += L)
+				Ops::store(p + i, x);
+			scalar::fill(p + i, n - i, v);
+		}
+
+		// Min or max value of n >= lanes elements
+		template <bool Max, Lane T>
+		static T reduce(const T* p, u64 n)
+		{
+			constexpr u64 L = lanes<T>;
+			reg acc = Ops::load(p);
+			for (u64 i = L; i < n; i += L)
+			{
+				// Overlap the tail, min/max don't mind
+				reg x = Ops::load(i + L <= n ? p + i : p + n - L);
+				reg m = Max ? Ops::template gt<T>(x, acc)
+				            : Ops::template gt<T>(acc, x);
+				acc = Ops::select(m, acc, x);
+			}
+
+			T buf[L];
+			Ops::store(buf, acc);
+			return buf[scalar::extreme<Max>(buf, L)];
+		}
+
+		template <bool Max, Lane T>
+		static u64 extreme(const T* p, u64 n)
+		{
+			if constexpr (!Ops::template ordered<T>)
+				return scalar::extreme<Max>(p, n);
+			else
+			{
+				// Reduce per chunk, then rescan only the chunk holding the first winner
+				constexpr u64 L = lanes<T>, CHUNK = 8192 / sizeof(T);
+				if (n < L) return scalar::extreme<Max>(p, n);
+
+				T best = p[0];
+				u64 at = 0;
+				for (u64 c = 0; c < n; c += CHUNK)
+				{
+					u64 len = n - c < CHUNK ? n - c : CHUNK;
+					T x = len < L ? p[c + scalar::extreme<Max>(p + c, len)]
+					              : reduce<Max>(p + c, len);
+					if (Max ? x > best : x < best)
+						best = x, at = c;
+				}
+				return at + find(p + at, n - at, best);
+			}
+		}
+
+		template <bool Desc, Lane T>
+		static bool sorted(const T* p, u64 n)
+		{
+			if constexpr (!Ops::template ordered<T>)
+				return scalar::sorted<Desc>(p, n);
+			else
+			{
+				constexpr u64 L = lanes<T>;
+				u64 i = 0;
+				for (; i + L < n; i += L)
+				{
+					reg a = Ops::load(p + i), b = Ops::load(p + i + 1);
+					reg bad = Desc ? Ops::template gt<T>(b, a)
+					               : Ops::template gt<T>(a, b);
+					if (Ops::mask(bad)) return false;
+				}
+				return scalar::sorted<Desc>(p + i, n - i);
+			}
+		}
+
+		template <Lane T>
+		static void reverse(T* p, u64 n)
+		{
+			constexpr u64 L = lanes<T>;
+			u64 lo = 0, hi = n;
+			for (; hi - lo >= 2 * L; lo += L, hi -= L)
+			{
+				reg a = Ops::load(p + lo), b = Ops::load(p + hi - L);
+				Ops::store(p + lo, Ops::template reverse<T>(b));
+				Ops::store(p + hi - L, Ops::template reverse<T>(a));
+			}
+			scalar::reverse(p + lo, hi - lo);
+		}
+	};
+
+	// flatten pulls the generic kernel into a function built for that ISA
+	template <class Fn>
+	__attribute__((target("avx2"), flatten)) auto on_avx2(Fn&& fn)
+	{
+		return fn.template operator()<kernel<avx2>>();
+	}
+
+	template <class Fn>
+	__attribute__((target("sse2"), flatten)) auto on_sse2(Fn&& fn)
+	{
+		return fn.template operator()<kernel<sse2>>();
+	}
+
+	template <class Fn>
+	inline auto dispatch(Fn&& fn)
+	{
+		switch (detect())
+		{
+			case level::AVX2: return on_avx2(fn);
+			case level::SSE2: return on_sse2(fn);
+			default: return fn.template operator()<scalar>();
+		}
+	}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#else
+	template <typename Itr>
+	concept Contiguous = false;
+
+	template <class Fn>
+	inline auto dispatch(Fn&& fn)
+	{
+		return fn.template operator()<scalar>();
+	}
+#endif
+
+	// Index of the first element equal to v, n if none
+	template <Lane T>
+	inline u64 find(const T* p, u64 n, T v)
+	{
+		return dispatch([&]<class K>() { return K::find(p, n, v); });
+	}
+
+	template <Lane T>
+	inline void fill(T* p, u64 n, T v)
+	{
+		dispatch([&]<class K>() { K::fill(p, n, v); });
+	}
+
+	// Index of the first minimum (or maximum), 0 if n == 0
+	template <bool Max, Lane T>
+	inline u64 extreme(const T* p, u64 n)
+	{
+		return dispatch([&]<class K>() { return K::template extreme<Max>(p, n); });
+	}
+
+	// No element ordered before its predecessor, descending if Desc
+	template <bool Desc, Lane T>
+	inline bool sorted(const T* p, u64 n)
+	{
+		return dispatch([&]<class K>() { return K::template sorted<Desc>(p, n); });
+	}
+
+	template <Lane T>
+	inline void reverse(T* p, u64 n)
+	{
+		dispatch([&]<class K>() { K::reverse(p, n); });
+	}
+}
+
+#endif
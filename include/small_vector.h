@@ -0,0 +1,351 @@
+#ifndef _NUTS_SMALL_VECTOR_
+#define _NUTS_SMALL_VECTOR_
+
+/** @file small_vector
+     *  Keep up to N elements inline, spill to the heap beyond that
+     *  Same interface as vector, but moving an inline one moves every element
+     */
+
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+
+#include "algorithm.h"
+#include "iterator.h"
+#include "memory.h"
+#include "type.h"
+
+#ifndef EXPAN_COEF
+#define EXPAN_COEF 2U
+#endif
+
+namespace nuts
+{
+	template <class T, u64 N, Allocator Alloc = allocator<T>>
+	class small_vector
+	{
+		static_assert(N > 0, "Inline capacity must be positive!");
+
+	public:
+		using value_type = T;
+		using pointer = T*;
+		using iterator = pointer;
+		using allocator_type = Alloc;
+		using self_type = small_vector<T, N, Alloc>;
+
+		small_vector() = default;                        // Void constructor
+		explicit small_vector(const Alloc& a) : alloc(a) {}// Init by an allocator
+		explicit small_vector(u64 n);                    // Init by size
+		explicit small_vector(u64 n, const T& val);      // Init by size and value
+		small_vector(const self_type& obj);              // Copy constructor
+		small_vector(self_type&& src) noexcept { move(src); }
+		small_vector(const std::initializer_list<T>& ilist);// Init by a {ilist}
+		~small_vector() noexcept { drop(); }
+
+		inline Alloc get_allocator() const noexcept { return alloc; }
+
+		inline T* data() const noexcept { return const_cast<T*>(data_ptr); }
+		inline u64 size() const noexcept { return v_size; }
+		inline u64 capacity() const noexcept { return v_capacity; }
+		inline bool empty() const noexcept { return v_size == 0; }
+		inline bool exist() const noexcept { return data_ptr != nullptr; }
+		inline bool is_inline() const noexcept { return data_ptr == inline_data(); }
+		static constexpr u64 inline_capacity() noexcept { return N; }
+
+		self_type& shrink_to_fit();// Move back inline if possible, or free unused heap memory
+		self_type& resize(u64 n);  // Reduce or expand capacity
+		self_type& reserve(u64 n) { return (n <= v_capacity) ? *this : resize(n); }
+		self_type& expand();
+
+		inline void clear();// Destroy all values, but keep the memory
+		void drop();        // Destroy all values and go back to inline storage
+		void print() const;
+
+		void push_back(const T& obj);
+		void push_back(T&& src);
+		void emplace_back();
+		void emplace_back(const T& val);
+		void emplace_back(T&& val);
+
+		inline void pop_back();
+		self_type& move(self_type& src) noexcept;
+
+		inline T& operator[](u64 n) noexcept { return data_ptr[n]; }
+		inline const T& operator[](u64 n) const noexcept
+		{
+			assert(n < v_size);
+			return data_ptr[n];
+		}
+
+		inline T& at(u64 n) noexcept
+		{
+			assert(n < v_size);
+			return data_ptr[n];
+		}
+
+		inline const T& at(u64 n) const noexcept
+		{
+			assert(n < v_size);
+			return data_ptr[n];
+		}
+
+		self_type& operator=(const self_type& obj);
+		inline self_type& operator=(self_type&& src) { return move(src); }
+
+		inline iterator begin() const { return data(); }
+		inline iterator end() const
+		{
+			return size() == 0 ? begin()
+			                   : begin() + size() - 1;
+		}
+
+		inline T& front() { return *begin(); }
+		inline T& back() { return *end(); }
+
+		inline const T& front() const { return *begin(); }
+		inline const T& back() const { return *end(); }
+
+		template <Forward_Itr Itr>
+		void assign(Itr st, Itr ed);
+
+		template <Forward_Itr Itr>
+		small_vector(Itr st, Itr ed);
+
+	private:
+		inline T* inline_data() const noexcept
+		{
+			return reinterpret_cast<T*>(const_cast<unsigned char*>(buf));
+		}
+
+		void reallocate(u64 n);// Move elements into heap storage of exactly n slots
+		void release();        // Free heap storage, elements must be gone
+
+	protected:
+		alignas(T) unsigned char buf[sizeof(T) * N];
+		pointer data_ptr = inline_data();
+		u64 v_size = 0, v_capacity = N;
+		[[no_unique_address]] Alloc alloc;
+	};
+
+	template <class T, u64 N, Allocator Alloc>
+	small_vector<T, N, Alloc>::small_vector(u64 n)
+	{
+		reserve(n);
+		for (u64 i = 0; i < n; i++)
+			(void) *new (data_ptr + i) T();
+		v_size = n;
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	small_vector<T, N, Alloc>::small_vector(u64 n, const T& val)
+	{
+		reserve(n);
+		uninitialized_fill_n(data_ptr, n, val);
+		v_size = n;
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	small_vector<T, N, Alloc>::small_vector(const self_type& obj)
+	    : alloc(obj.alloc)
+	{
+		reserve(obj.size());
+		uninitialized_copy_n(obj.data(), obj.size(), data_ptr);
+		v_size = obj.size();
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	small_vector<T, N, Alloc>::
+	        small_vector(const std::initializer_list<T>& ilist)
+	{
+		reserve(ilist.size());
+		for (const T& x: ilist) push_back(x);
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	template <Forward_Itr Itr>
+	small_vector<T, N, Alloc>::small_vector(Itr st, Itr ed)
+	{
+		assign(st, ed);
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	inline void small_vector<T, N, Alloc>::clear()
+	{
+		destroy_n(data_ptr, v_size);
+		v_size = 0;
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	void small_vector<T, N, Alloc>::release()
+	{
+		if (!is_inline())
+			alloc.deallocate(data_ptr, v_capacity);
+		data_ptr = inline_data();
+		v_capacity = N;
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	void small_vector<T, N, Alloc>::drop()
+	{
+		clear();
+		release();
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	void small_vector<T, N, Alloc>::reallocate(u64 n)
+	{
+		T* tmp = alloc.allocate(n);
+		relocate_n(data_ptr, v_size, tmp);
+		if (!is_inline())
+			alloc.deallocate(data_ptr, v_capacity);
+		data_ptr = tmp;
+		v_capacity = n;
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	small_vector<T, N, Alloc>& small_vector<T, N, Alloc>::shrink_to_fit()
+	{
+		if (is_inline() || v_capacity == v_size)
+			return *this;
+		if (v_size <= N)
+		{
+			T* heap = data_ptr;
+			u64 cap = v_capacity;
+			relocate_n(heap, v_size, inline_data());
+			alloc.deallocate(heap, cap);
+			data_ptr = inline_data();
+			v_capacity = N;
+		}
+		else
+			reallocate(v_size);
+		return *this;
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	small_vector<T, N, Alloc>& small_vector<T, N, Alloc>::resize(u64 n)
+	{
+		if (n > v_capacity)
+			reallocate(n);
+		if (n < v_size)
+		{
+			destroy_n(data_ptr + n, v_size - n);
+			v_size = n;
+		}
+		return *this;
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	small_vector<T, N, Alloc>& small_vector<T, N, Alloc>::expand()
+	{
+		return reserve(v_capacity * EXPAN_COEF);
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	void small_vector<T, N, Alloc>::emplace_back()
+	{
+		if (v_capacity == v_size)
+			expand();
+		(void) *new (data_ptr + v_size++) T();
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	void small_vector<T, N, Alloc>::emplace_back(T&& val)
+	{
+		if (v_capacity == v_size)
+			expand();
+		(void) *new (data_ptr + v_size++) T(nuts::move(val));
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	void small_vector<T, N, Alloc>::emplace_back(const T& val)
+	{
+		if (v_capacity == v_size)
+		{
+			// val may live in the storage being relocated
+			T tmp(val);
+			expand();
+			(void) *new (data_ptr + v_size++) T(nuts::move(tmp));
+			return;
+		}
+		(void) *new (data_ptr + v_size++) T(val);
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	void small_vector<T, N, Alloc>::push_back(const T& src)
+	{
+		emplace_back(src);
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	void small_vector<T, N, Alloc>::push_back(T&& src)
+	{
+		emplace_back(nuts::move(src));
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	inline void small_vector<T, N, Alloc>::pop_back()
+	{
+		if (!empty())
+			data_ptr[--v_size].~T();
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	small_vector<T, N, Alloc>&
+	small_vector<T, N, Alloc>::move(self_type& src) noexcept
+	{
+		if (this == &src) return *this;
+		drop();
+		alloc = src.alloc;
+
+		if (src.is_inline())
+		{
+			// Nothing to steal, elements move one by one
+			relocate_n(src.data_ptr, src.v_size, data_ptr);
+			v_size = src.v_size;
+		}
+		else
+		{
+			data_ptr = src.data_ptr;
+			v_size = src.v_size;
+			v_capacity = src.v_capacity;
+			src.data_ptr = src.inline_data();
+			src.v_capacity = N;
+		}
+		src.v_size = 0;
+		return *this;
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	small_vector<T, N, Alloc>&
+	small_vector<T, N, Alloc>::operator=(const self_type& obj)
+	{
+		if (this == &obj) return *this;
+		clear();
+		reserve(obj.size());
+		uninitialized_copy_n(obj.data(), obj.size(), data_ptr);
+		v_size = obj.size();
+		return *this;
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	void small_vector<T, N, Alloc>::print() const
+	{
+		auto print = [&](const auto& x) {
+			nuts::print(x);
+			if (&x != &back()) printf(", ");
+		};
+
+		printf("small_vector @%#llx = [", (u64) data());
+		if (!empty()) for_each(*this, print);
+		printf("]\n");
+	}
+
+	template <class T, u64 N, Allocator Alloc>
+	template <Forward_Itr Itr>
+	void small_vector<T, N, Alloc>::assign(Itr st, Itr ed)
+	{
+		for_each(st, ed, [&](const auto& x) { push_back(x); });
+	}
+}
+
+#endif
@@ -4,56 +4,90 @@
 #include "unordered_set.h"
 #include "utility.h"
 
+#ifdef NUTS_FLAT_HASH
+#include "flat_hash_map.h"
+#endif
+
 namespace nuts
 {
 	template <typename K, typename V,
-	          typename Hasher = nuts::hash<K>>
+	          typename Hasher = nuts::hash<K>,
+	          Allocator Alloc = allocator<pair<K, V>>,
+	          BucketIndexer Indexer = prime_fastmod>
 	class unordered_map
-	    : public unordered_set<pair<K, V>, Hasher>
+	    : public unordered_set<pair<K, V>, Hasher, Alloc, Indexer, select_first<pair<K, V>>>
 	{
 	public:
 		using value_type = pair<K, V>;
 		using k_type = K;
 		using v_type = V;
-		using base_type = unordered_set<pair<K, V>, Hasher>;
-		using self_type = unordered_map<K, V, Hasher>;
-		using bucket_type = list<pair<K, V>>;
+		using base_type = unordered_set<pair<K, V>, Hasher, Alloc, Indexer, select_first<pair<K, V>>>;
+		using self_type = unordered_map<K, V, Hasher, Alloc, Indexer>;
+		using bucket_type = typename base_type::bucket_type;
+		using bucket_array = typename base_type::bucket_array;
 		using itr_type = typename base_type::iterator;
 
 		using base_type::_size;
 		using base_type::bucket;
-		using base_type::bucket_size;
+		using base_type::bucket_count;
+		using base_type::get_index;
 		using base_type::hash_fn;
 		using base_type::npos;
 
-		unordered_map();
-		unordered_map(const self_type& src);
+		unordered_map() = default;
+		explicit unordered_map(u64 n) : base_type(n) {}
+		unordered_map(const self_type& src) : base_type(src) {}
 		unordered_map(self_type&& src) { move(src); }
 		unordered_map(const std::initializer_list<value_type>& ilist);
-		~unordered_map() { base_type::clear(); }
 
-		inline u64 get_index(const K& _k)
-		        const { return hash_fn(_k) % *bucket_size; }
+		template <Forward_Itr Itr>
+		unordered_map(Itr st, Itr ed) : base_type(st, ed) {}
+		~unordered_map() = default;
 
 		self_type& move(self_type& src);
-		void rehash();
-		bool contains(const K& _k) const;
-		itr_type find(const K& _k) const;
+
+		// Lookups take K or any Q with Lookup_Key<Q, K, Hasher>, e.g. const char* for string
+		template <Lookup_Key<K, Hasher> Q = K>
+		bool contains(const Q& _k) const;
+
+		template <Lookup_Key<K, Hasher> Q = K>
+		itr_type find(const Q& _k) const;
+
+		template <Lookup_Key<K, Hasher> Q = K>
+		bool erase(const Q& _k);
 
 		V& at(const K& _k);
 		const V& at(const K& _k) const;
 
 		V& operator[](const K& _k);
+		V& operator[](K&& _k);
 		const V& operator[](const K& _k) const;
 
+		// One probe, V is built from args only if _k is absent; true if inserted
+		template <typename Q, typename... Args>
+		    requires Lookup_Key<Q, K, Hasher>
+		pair<itr_type, bool> try_emplace(Q&& _k, Args&&... args);
+
+		// One probe, assigns _val to an existing V or builds a new one from it
+		template <typename Q, typename M>
+		    requires Lookup_Key<Q, K, Hasher>
+		pair<itr_type, bool> insert_or_assign(Q&& _k, M&& _val);
+
 		void insert(const K& _k, const V& _val);
 		void insert(const pair<K, V>& _p);
-		bool erase(const K& _k);
 
 		self_type& operator=(const self_type& src);
 		self_type& operator=(self_type&& src) { return move(src); }
 
 		void print() const;
+
+	protected:
+		using base_type::bucket_of;
+		using base_type::insert_index;
+		using base_type::locate;
+		using base_type::make_itr;
+		using base_type::migrate;
+		using base_type::migrate_step;
 	};
 
 	// Deduction Guide
@@ -61,69 +95,59 @@ namespace nuts
 	unordered_map(const std::initializer_list<pair<K, V>>&)
 	        -> unordered_map<K, V>;
 
+#ifdef NUTS_FLAT_HASH
+	template <class K, class V, class Hasher = nuts::hash<K>>
+	using hash_map = flat_hash_map<K, V, Hasher>;
+#else
 	template <class K, class V, class Hasher = nuts::hash<K>>
 	using hash_map = unordered_map<K, V, Hasher>;
+#endif
 
-	template <class K, class V, class Hasher>
-	unordered_map<K, V, Hasher>::unordered_map()
-	{
-		vector<bucket_type> tmp(*bucket_size);
-		bucket.move(tmp);
-	}
-
-	template <class K, class V, class Hasher>
-	unordered_map<K, V, Hasher>::
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	unordered_map<K, V, Hasher, Alloc, Indexer>::
 	        unordered_map(const std::initializer_list<value_type>& ilist)
+	    : base_type(ilist.size())
 	{
 		for (auto& i: ilist) insert(i);
 	}
 
-	template <class K, class V, class Hasher>
-	unordered_map<K, V, Hasher>::
-	        unordered_map(const self_type& src)
-	{
-		bucket_size = src.bucket_size;
-		bucket = src.bucket;
-		_size = src._size;
-	}
-
-	template <class K, class V, class Hasher>
-	unordered_map<K, V, Hasher>&
-	unordered_map<K, V, Hasher>::move(self_type& src)
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	unordered_map<K, V, Hasher, Alloc, Indexer>&
+	unordered_map<K, V, Hasher, Alloc, Indexer>::move(self_type& src)
 	{
 		base_type::move(src);
 		return *this;
 	}
 
-	template <class K, class V, class Hasher>
-	bool unordered_map<K, V, Hasher>::contains(const K& _k) const
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	template <Lookup_Key<K, Hasher> Q>
+	bool unordered_map<K, V, Hasher, Alloc, Indexer>::contains(const Q& _k) const
 	{
-		return find(_k) != npos;
+		return locate(_k).node != bucket_type::npos;
 	}
 
-	template <class K, class V, class Hasher>
-	typename unordered_set<nuts::pair<K, V>, Hasher>::iterator
-	unordered_map<K, V, Hasher>::find(const K& _k) const
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	template <Lookup_Key<K, Hasher> Q>
+	typename unordered_map<K, V, Hasher, Alloc, Indexer>::itr_type
+	unordered_map<K, V, Hasher, Alloc, Indexer>::find(const Q& _k) const
 	{
-		u64 i = get_index(_k);
-		auto it = nuts::find_if(bucket[i],
-		                        [&](const auto& p) { return p._0() == _k; });
-		if (it == bucket_type::npos)
+		auto p = locate(_k);
+		if (p.node == bucket_type::npos)
 			return npos;
 		else
-			return {advance(bucket.begin(), i), bucket.end(), it};
+			return make_itr(p);
 	}
 
-	template <class K, class V, class Hasher>
-	V& unordered_map<K, V, Hasher>::at(const K& _k)
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	V& unordered_map<K, V, Hasher, Alloc, Indexer>::at(const K& _k)
 	{
 		auto it = find(_k);
 		assert(it != base_type::npos);
 		return it->second;
 	}
 
-	template <class K, class V, class Hasher>
-	const V& unordered_map<K, V, Hasher>::
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	const V& unordered_map<K, V, Hasher, Alloc, Indexer>::
 	        at(const K& _k) const
 	{
 		auto it = find(_k);
@@ -131,81 +155,101 @@ namespace nuts
 		return it->second;
 	}
 
-	template <class K, class V, class Hasher>
-	V& unordered_map<K, V, Hasher>::operator[](const K& _k)
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	V& unordered_map<K, V, Hasher, Alloc, Indexer>::operator[](const K& _k)
 	{
-		auto it = find(_k);
-		if (it != base_type::npos)
-			return it->second;
-		else
-		{
-			if (_size == *bucket_size)
-				rehash();
-			u64 i = get_index(_k);
-			bucket[i].emplace_back();
-			bucket[i].back().first = _k;
-			++_size;
-			return bucket[i].back().second;
-		}
+		return try_emplace(_k).first->second;
 	}
 
-	template <class K, class V, class Hasher>
-	const V& unordered_map<K, V, Hasher>::
-	operator[](const K& _k) const
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	V& unordered_map<K, V, Hasher, Alloc, Indexer>::operator[](K&& _k)
 	{
-		assert(find(_k) != npos);
-		return (*this)[_k];
+		return try_emplace(nuts::move(_k)).first->second;
 	}
 
-	template <class K, class V, class Hasher>
-	void unordered_map<K, V, Hasher>::
-	        insert(const K& _k, const V& _val)
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	const V& unordered_map<K, V, Hasher, Alloc, Indexer>::
+	operator[](const K& _k) const
 	{
-		(*this)[_k] = _val;
+		return at(_k);
 	}
 
-	template <class K, class V, class Hasher>
-	void unordered_map<K, V, Hasher>::
-	        insert(const pair<K, V>& _p)
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	template <typename Q, typename... Args>
+	    requires Lookup_Key<Q, K, Hasher>
+	pair<typename unordered_map<K, V, Hasher, Alloc, Indexer>::itr_type, bool>
+	unordered_map<K, V, Hasher, Alloc, Indexer>::try_emplace(Q&& _k, Args&&... args)
 	{
-		(*this)[_p.first] = _p.second;
+		migrate(migrate_step);
+		auto p = locate(_k);
+		if (p.node != bucket_type::npos)
+			return {make_itr(p), false};
+
+		u64 i = insert_index(p.hash);
+		bucket[i].emplace_back(p.hash, in_place, static_cast<Q&&>(_k),
+		                       static_cast<Args&&>(args)...);
+		++_size;
+		return {make_itr({i, false, bucket[i].end(), p.hash}), true};
 	}
 
-	template <class K, class V, class Hasher>
-	bool unordered_map<K, V, Hasher>::
-	        erase(const K& _k)
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	template <typename Q, typename M>
+	    requires Lookup_Key<Q, K, Hasher>
+	pair<typename unordered_map<K, V, Hasher, Alloc, Indexer>::itr_type, bool>
+	unordered_map<K, V, Hasher, Alloc, Indexer>::insert_or_assign(Q&& _k, M&& _val)
 	{
-		pair<K, V> tmp;
-		tmp.first = _k;
-		return base_type::erase(tmp);
+		migrate(migrate_step);
+		auto p = locate(_k);
+		if (p.node != bucket_type::npos)
+		{
+			(*p.node).value.second = static_cast<M&&>(_val);
+			return {make_itr(p), false};
+		}
+
+		u64 i = insert_index(p.hash);
+		bucket[i].emplace_back(p.hash, in_place, static_cast<Q&&>(_k),
+		                       static_cast<M&&>(_val));
+		++_size;
+		return {make_itr({i, false, bucket[i].end(), p.hash}), true};
 	}
 
-	template <class K, class V, class Hasher>
-	void unordered_map<K, V, Hasher>::rehash()
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	void unordered_map<K, V, Hasher, Alloc, Indexer>::
+	        insert(const K& _k, const V& _val)
 	{
-		if (bucket_size != PRIME_LIST + 61)
-			bucket_size++;
-		vector<bucket_type> tmp(*bucket_size);
+		insert_or_assign(_k, _val);
+	}
 
-		auto opr = [&](pair<K, V>& x) {
-			u64 index = get_index(x.first);
-			tmp[index].push_back(nuts::move(x));
-		};
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	void unordered_map<K, V, Hasher, Alloc, Indexer>::
+	        insert(const pair<K, V>& _p)
+	{
+		insert_or_assign(_p.first, _p.second);
+	}
 
-		for_each(*this, opr);
-		bucket.move(tmp);
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	template <Lookup_Key<K, Hasher> Q>
+	bool unordered_map<K, V, Hasher, Alloc, Indexer>::erase(const Q& _k)
+	{
+		migrate(migrate_step);
+		auto p = locate(_k);
+		if (p.node == bucket_type::npos)
+			return false;
+		bucket_of(p).erase(p.node);
+		--_size;
+		return true;
 	}
 
-	template <class K, class V, class Hasher>
-	unordered_map<K, V, Hasher>& unordered_map<K, V, Hasher>::
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	unordered_map<K, V, Hasher, Alloc, Indexer>& unordered_map<K, V, Hasher, Alloc, Indexer>::
 	operator=(const self_type& src)
 	{
 		base_type::operator=(src);
 		return *this;
 	}
 
-	template <class K, class V, class Hasher>
-	void unordered_map<K, V, Hasher>::print() const
+	template <class K, class V, class Hasher, Allocator Alloc, BucketIndexer Indexer>
+	void unordered_map<K, V, Hasher, Alloc, Indexer>::print() const
 	{
 		auto pr = [&](const auto& x) {
 			nuts::print(x);
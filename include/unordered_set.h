@@ -1,100 +1,80 @@
 #ifndef _NUTS_HASH_SET_
 #define _NUTS_HASH_SET_
 
+#include <cassert>
+
+#include "bucket_index.h"
 #include "functional.h"
+#include "hash_stats.h"
 #include "list.h"
 #include "move.h"
 #include "range.h"
 #include "vector.h"
 
+/** @file unordered_set
+     *  Separate chaining over a vector of lists, sized by a BucketIndexer
+     *  Every node caches its full hash: lookups compare it before the key,
+     *  and growth relinks the nodes into the new array without rehashing or allocating
+     *  KeyOf picks the hashed key out of a value, so unordered_map shares this body
+     *  Growth is stop-the-world by default, set_rehash_step(n) makes it incremental:
+     *  the old array stays alive and each insert/erase moves n of its buckets over,
+     *  lookups probe the new array first, then the old one until it drains
+     */
+
+#ifdef NUTS_FLAT_HASH
+#include "flat_hash_set.h"
+#endif
+
 namespace nuts
 {
-	// Capacity of the bucket
-	static constexpr u64 PRIME_LIST[] = {
-	        /* 0     */ 5ULL,
-	        /* 1     */ 11ULL,
-	        /* 2     */ 23ULL,
-	        /* 3     */ 47ULL,
-	        /* 4     */ 97ULL,
-	        /* 5     */ 199ULL,
-	        /* 6     */ 409ULL,
-	        /* 7     */ 823ULL,
-	        /* 8     */ 1741ULL,
-	        /* 9     */ 3469ULL,
-	        /* 10    */ 6949ULL,
-	        /* 11    */ 14033ULL,
-	        /* 12    */ 28411ULL,
-	        /* 13    */ 57557ULL,
-	        /* 14    */ 116731ULL,
-	        /* 15    */ 236897ULL,
-	        /* 16    */ 480881ULL,
-	        /* 17    */ 976369ULL,
-	        /* 18    */ 1982627ULL,
-	        /* 19    */ 4026031ULL,
-	        /* 20    */ 8175383ULL,
-	        /* 21    */ 16601593ULL,
-	        /* 22    */ 33712729ULL,
-	        /* 23    */ 68460391ULL,
-	        /* 24    */ 139022417ULL,
-	        /* 25    */ 282312799ULL,
-	        /* 26    */ 573292817ULL,
-	        /* 27    */ 1164186217ULL,
-	        /* 28    */ 2364114217ULL,
-	        /* 29    */ 4294967291ULL,
-	        /* 30    */ 8589934583ULL,
-	        /* 31    */ 17179869143ULL,
-	        /* 32    */ 34359738337ULL,
-	        /* 33    */ 68719476731ULL,
-	        /* 34    */ 137438953447ULL,
-	        /* 35    */ 274877906899ULL,
-	        /* 36    */ 549755813881ULL,
-	        /* 37    */ 1099511627689ULL,
-	        /* 38    */ 2199023255531ULL,
-	        /* 39    */ 4398046511093ULL,
-	        /* 40    */ 8796093022151ULL,
-	        /* 41    */ 17592186044399ULL,
-	        /* 42    */ 35184372088777ULL,
-	        /* 43    */ 70368744177643ULL,
-	        /* 44    */ 140737488355213ULL,
-	        /* 45    */ 281474976710597ULL,
-	        /* 46    */ 562949953421231ULL,
-	        /* 47    */ 1125899906842597ULL,
-	        /* 48    */ 2251799813685119ULL,
-	        /* 49    */ 4503599627370449ULL,
-	        /* 50    */ 9007199254740881ULL,
-	        /* 51    */ 18014398509481951ULL,
-	        /* 52    */ 36028797018963913ULL,
-	        /* 53    */ 72057594037927931ULL,
-	        /* 54    */ 144115188075855859ULL,
-	        /* 55    */ 288230376151711717ULL,
-	        /* 56    */ 576460752303423433ULL,
-	        /* 57    */ 1152921504606846883ULL,
-	        /* 58    */ 2305843009213693951ULL,
-	        /* 59    */ 4611686018427387847ULL,
-	        /* 60    */ 9223372036854775783ULL,
-	        /* 61    */ 18446744073709551557ULL,
+	// Caller guarantees no key repeats, in the range or in the table
+	struct unique_keys_t
+	{
+		explicit unique_keys_t() = default;
+	};
+
+	inline constexpr unique_keys_t unique_keys {};
+
+	// Chain element, the value next to its full hash
+	template <class K>
+	struct hashed_value
+	{
+		u64 hash;
+		K value;
+
+		template <typename... Args>
+		explicit hashed_value(u64 h, Args&&... args)
+		    : hash(h), value(static_cast<Args&&>(args)...) {}
 	};
 
-	template <typename K, typename Hasher = hash<K>>
+	template <typename K, typename Hasher = hash<K>,
+	          Allocator Alloc = allocator<K>,
+	          BucketIndexer Indexer = prime_fastmod,
+	          typename KeyOf = identity<K>>
 	class unordered_set
 	{
 	public:
-		using prime_pointer = const u64*;
 		using value_type = K;
-		using self_type = unordered_set<K, Hasher>;
-		using bucket_type = list<K>;
+		using key_type = typename KeyOf::type;
+		using allocator_type = Alloc;
+		using indexer_type = Indexer;
+		using self_type = unordered_set<K, Hasher, Alloc, Indexer, KeyOf>;
+		using bucket_type = list<hashed_value<K>, rebind_alloc<Alloc, hashed_value<K>>>;
+		using bucket_array = vector<bucket_type, rebind_alloc<Alloc, bucket_type>>;
 
 		class iterator
 		    : public forward_iterator
 		{
 		public:
 			using value_type = K;
-			using Outside = typename vector<bucket_type>::iterator;
+			using Outside = typename bucket_array::iterator;
 			using Inside = typename bucket_type::iterator;
 
 		protected:
 			Outside out_itr, bkt_end;
 			Inside in_itr;
+			Outside nxt_itr, nxt_end;// Array to go on with, set while in the old one
+			bool has_nxt = false;
 
 		public:
 			iterator() {}
@@ -102,27 +82,42 @@ namespace nuts
 			         const Inside& i) : out_itr(o), bkt_end(b),
 			                            in_itr(i) {}
 
-			iterator(const iterator& src) : out_itr(src.out_itr),
-			                                bkt_end(src.bkt_end),
-			                                in_itr(src.in_itr) {}
+			iterator(const Outside& o, const Outside& b, const Inside& i,
+			         const Outside& no, const Outside& nb)
+			    : out_itr(o), bkt_end(b), in_itr(i),
+			      nxt_itr(no), nxt_end(nb), has_nxt(true) {}
+
+			iterator(const iterator& src) = default;
+			iterator& operator=(const iterator& src) = default;
 			~iterator() = default;
 
-			K& operator*() { return *in_itr; }
-			const K& operator*() const { return *in_itr; }
-			const Inside& operator->() const { return in_itr; }
+			K& operator*() { return (*in_itr).value; }
+			const K& operator*() const { return (*in_itr).value; }
+			K* operator->() const { return &in_itr->value; }
 
 			iterator& operator++()
 			{
 				++in_itr;
 				if (in_itr == bucket_type::npos)
 				{
-					while (out_itr != bkt_end)
+					for (;;)
 					{
-						++out_itr;
+						while (out_itr != bkt_end)
+						{
+							++out_itr;
+							if (!out_itr->empty())
+							{
+								in_itr = out_itr->begin();
+								return *this;
+							}
+						}
+						if (!has_nxt) break;
+						out_itr = nxt_itr, bkt_end = nxt_end;
+						has_nxt = false;
 						if (!out_itr->empty())
 						{
 							in_itr = out_itr->begin();
-							return *this;
+							break;
 						}
 					}
 				}
@@ -155,8 +150,17 @@ namespace nuts
 			}
 		};
 
+		// Old buckets not yet migrated come first, then the new array
 		iterator begin() const
 		{
+			if (rehashing())
+			{
+				auto ed = next(old_bucket.end());
+				for (auto it = advance(old_bucket.begin(), migrate_pos); it != ed; ++it)
+					if (!it->empty())
+						return {it, old_bucket.end(), it->begin(),
+						        bucket.begin(), bucket.end()};
+			}
 			auto ed = next(bucket.end());
 			for (auto it = bucket.begin(); it != ed; ++it)
 				if (!it->empty())
@@ -169,14 +173,26 @@ namespace nuts
 			auto ed = prev(bucket.begin());
 			for (auto it = bucket.end(); it != ed; --it)
 				if (!it->empty())
-					return {it, bucket.end(), it->begin()};
+					return {it, bucket.end(), it->end()};
+			if (rehashing())
+			{
+				auto st = prev(advance(old_bucket.begin(), migrate_pos));
+				for (auto it = old_bucket.end(); it != st; --it)
+					if (!it->empty())
+						return {it, old_bucket.end(), it->end(),
+						        bucket.begin(), bucket.end()};
+			}
 			return npos;
 		}
 
-		unordered_set();
+		unordered_set() : unordered_set(0) {}
+		explicit unordered_set(u64 n);// Room for n elements without a rehash
 		unordered_set(const self_type& src);
 		unordered_set(self_type&& src) { move(src); }
 		unordered_set(const std::initializer_list<K>& ilist);
+
+		template <Forward_Itr Itr>
+		unordered_set(Itr st, Itr ed) : unordered_set(0) { insert_range(st, ed); }
 		~unordered_set() { clear(); }
 
 		K& front() { return *begin(); }
@@ -188,175 +204,486 @@ namespace nuts
 		inline bool empty() const { return _size == 0; };
 		self_type& move(self_type& src);
 
-		inline u64 get_index(const K& _k)
-		        const { return hash_fn(_k) % *bucket_size; }
+		inline u64 bucket_count() const { return index_fn.size(); }
+
+		template <typename Q = key_type>
+		inline u64 get_index(const Q& _k)
+		        const { return index_fn(hash_fn(_k)); }
 
 		iterator find(const K& _k) const;
 		bool contains(const K& _k) const;
+
+		// Batched lookups of keys[0, n): all hashes first, then prefetch
+		// the buckets and their head nodes, then resolve, so misses overlap
+		template <typename Q = key_type>
+		void find_many(const Q* keys, u64 n, iterator* out) const;
+
+		// Returns how many of keys[0, n) are present
+		template <typename Q = key_type>
+		u64 contains_many(const Q* keys, u64 n, bool* out) const;
+
 		void insert(const K& _k);
 		void insert(K&& _k);
 		bool erase(const K& _k);
-		void rehash();
+		void rehash();// Grow now, stop-the-world
 		void clear();
 
+		// Buckets for n elements under the max load factor, rehashes at once if short
+		void reserve(u64 n);
+
+		inline f64 load_factor() const { return static_cast<f64>(_size) / bucket_count(); }
+		inline f64 max_load_factor() const { return max_load; }
+		void max_load_factor(f64 ml);
+
+		// Inserts [st, ed], reserving once up front
+		template <Forward_Itr Itr>
+		void insert_range(Itr st, Itr ed);
+
+		// Same, without looking each key up first
+		template <Forward_Itr Itr>
+		void insert_range(unique_keys_t, Itr st, Itr ed);
+
+		// Buckets migrated per insert/erase while growing, 0 (default) rehashes at once
+		void set_rehash_step(u64 n);
+		inline u64 rehash_step() const { return migrate_step; }
+		inline bool rehashing() const { return migrate_pos < old_bucket.size(); }
+
 		self_type& operator=(const self_type& src);
 		self_type& operator=(self_type&& src) { return move(src); }
 
+		// Shape of the table, old and new arrays together while rehashing
+		hash_stats stats() const;
+
 		void print() const;
 		void print_as_table() const;
 
 	protected:
-		prime_pointer bucket_size = PRIME_LIST;
+		using node_itr = typename bucket_type::iterator;
+		using node_ptr = typename bucket_type::node_ptr;
+
+		// Where a key is, or would be: node is bucket_type::npos if absent
+		struct probe
+		{
+			u64 index;
+			bool old;
+			node_itr node;
+			u64 hash;
+		};
+
+		Indexer index_fn, old_index;
 		u64 _size = 0;
-		vector<bucket_type> bucket;
+		bucket_array bucket, old_bucket;
+		u64 migrate_pos = 0, migrate_step = 0;
+		f64 max_load = 1.0;
+		[[no_unique_address]] probe_counter probe_stat;
+
+		// n counts the nodes visited, keys are only compared on a hash match
+		template <typename Q>
+		static node_itr find_in(const bucket_type& b, const Q& _k, u64 h, u64& n)
+		{
+			return nuts::find_if(b, [&](const hashed_value<K>& x) {
+				return ++n, x.hash == h && key_of(x.value) == _k;
+			});
+		}
+
+		static constexpr u64 BATCH = 16;
+
+		template <typename Q>
+		probe locate(const Q& _k) const { return locate(_k, hash_fn(_k)); }
+
+		// New array first; already migrated old buckets are empty
+		template <typename Q>
+		probe locate(const Q& _k, u64 h) const
+		{
+			u64 n = 0;
+			const u64 i = index_fn(h);
+			auto it = find_in(bucket[i], _k, h, n);
+			if (it != bucket_type::npos || !rehashing())
+			{
+				probe_stat.add(n);
+				return {i, false, it, h};
+			}
+			const u64 j = old_index(h);
+			it = find_in(old_bucket[j], _k, h, n);
+			probe_stat.add(n);
+			return {j, true, it, h};
+		}
+
+		inline bucket_type& bucket_of(const probe& p)
+		{
+			return p.old ? old_bucket[p.index] : bucket[p.index];
+		}
+
+		iterator make_itr(const probe& p) const
+		{
+			if (p.old)
+				return {advance(old_bucket.begin(), p.index), old_bucket.end(),
+				        p.node, bucket.begin(), bucket.end()};
+			return {advance(bucket.begin(), p.index), bucket.end(), p.node};
+		}
+
+		template <typename Q, class Fn>
+		void locate_many(const Q* keys, u64 n, Fn&& fn) const;
+
+		void migrate(u64 n);
+		void grow();
+		void rebuild();// Relink every node into a fresh array of bucket_count()
+
+		// Moves every node of src to the back of its bucket in dst, by the cached hash
+		void relink(bucket_type& src, bucket_array& dst)
+		{
+			while (!src.empty())
+			{
+				node_ptr p = src.unlink(src.data());
+				dst[index_fn(p->data.hash)].link_back(p);
+			}
+		}
+
+		inline u64 buckets_for(u64 n) const
+		{
+			return static_cast<u64>(static_cast<f64>(n) / max_load) + 1;
+		}
+
+		template <Forward_Itr Itr>
+		static u64 count_of(Itr st, Itr ed)
+		{
+			if constexpr (Random_Itr<Itr>)
+				return ed - st + 1;
+			else
+			{
+				u64 res = 0;
+				for_each(st, ed, [&](const auto&) { ++res; });
+				return res;
+			}
+		}
+
+		// Bucket of the new array that a missing key of hash h goes to, grows first if full
+		// While rehashing, each insert drains old buckets / inserts left before the next grow,
+		// so the old array is empty by then and no insert pays for more than that share
+		u64 insert_index(u64 h)
+		{
+			if (rehashing())
+			{
+				const f64 room = max_load * bucket_count() - static_cast<f64>(_size);
+				const u64 left = old_bucket.size() - migrate_pos;
+				migrate(room < 2 ? left : static_cast<u64>(left / static_cast<u64>(room)) + 1);
+			}
+			if (static_cast<f64>(_size + 1) > max_load * bucket_count()) grow();
+			return index_fn(h);
+		}
 
 	public:
 		static constexpr Hasher hash_fn {};
+		static constexpr KeyOf key_of {};
 		static const iterator npos;
 	};
 
-	template <class K, class Hasher>
-	const typename unordered_set<K, Hasher>::iterator
-	        unordered_set<K, Hasher>::npos;
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	const typename unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::iterator
+	        unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::npos;
 
 	// Deduction Guide
 	template <class K>
 	unordered_set(const std::initializer_list<K>&) -> unordered_set<K>;
 
+	// Define NUTS_FLAT_HASH to switch hash_set to open-addressing
+#ifdef NUTS_FLAT_HASH
+	template <class K, class Hasher = nuts::hash<K>>
+	using hash_set = flat_hash_set<K, Hasher>;
+#else
 	template <class K, class Hasher = nuts::hash<K>>
 	using hash_set = unordered_set<K, Hasher>;
+#endif
 
-	template <class K, class Hasher>
-	unordered_set<K, Hasher>::unordered_set()
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::unordered_set(u64 n)
 	{
-		vector<bucket_type> tmp(*bucket_size);
+		index_fn.fit(buckets_for(n));
+		bucket_array tmp(bucket_count());
 		bucket.move(tmp);
 	}
-
-	template <class K, class Hasher>
-	unordered_set<K, Hasher>::
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::
 	        unordered_set(const self_type& src)
-	    : bucket_size(src.bucket_size),
+	    : index_fn(src.index_fn),
+	      old_index(src.old_index),
+	      _size(src._size),
 	      bucket(src.bucket),
-	      _size(src._size)
+	      old_bucket(src.old_bucket),
+	      migrate_pos(src.migrate_pos),
+	      migrate_step(src.migrate_step),
+	      max_load(src.max_load)
 	{}
 
-	template <class K, class Hasher>
-	unordered_set<K, Hasher>::
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::
 	        unordered_set(const std::initializer_list<K>& ilist)
+	    : unordered_set(ilist.size())
 	{
-		while (ilist.size() > *bucket_size &&
-		       *bucket_size != PRIME_LIST[61]) ++bucket_size;
-		vector<bucket_type> tmp(*bucket_size);
-		bucket.move(tmp);
 		for (const auto& x: ilist) insert(x);
 	}
 
-	template <class K, class Hasher>
-	typename unordered_set<K, Hasher>::iterator
-	unordered_set<K, Hasher>::find(const K& _k) const
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	typename unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::iterator
+	unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::find(const K& _k) const
 	{
-		u64 i = get_index(_k);
-		auto it = nuts::find(bucket[i], _k);
-		if (it == bucket_type::npos)
+		auto p = locate(key_of(_k));
+		if (p.node == bucket_type::npos)
 			return npos;
 		else
-			return {advance(bucket.begin(), i), bucket.end(), it};
+			return make_itr(p);
 	}
 
-	template <class K, class Hasher>
-	unordered_set<K, Hasher>& unordered_set<K, Hasher>::
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	unordered_set<K, Hasher, Alloc, Indexer, KeyOf>& unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::
 	        move(self_type& src)
 	{
-		bucket_size = src.bucket_size;
+		index_fn = src.index_fn;
+		old_index = src.old_index;
 		_size = src._size;
 		bucket.move(src.bucket);
-		bucket_size = PRIME_LIST;
-		src._size = 0;
+		old_bucket.move(src.old_bucket);
+		migrate_pos = src.migrate_pos;
+		migrate_step = src.migrate_step;
+		max_load = src.max_load;
+		src.index_fn.reset();
+		src._size = src.migrate_pos = 0;
 		return *this;
 	}
 
-	template <class K, class Hasher>
-	unordered_set<K, Hasher>& unordered_set<K, Hasher>::
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	unordered_set<K, Hasher, Alloc, Indexer, KeyOf>& unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::
 	operator=(const self_type& src)
 	{
-		bucket_size = src.bucket_size;
+		index_fn = src.index_fn;
+		old_index = src.old_index;
 		bucket = src.bucket;
+		old_bucket = src.old_bucket;
 		_size = src._size;
+		migrate_pos = src.migrate_pos;
+		migrate_step = src.migrate_step;
+		max_load = src.max_load;
 		return *this;
 	}
 
-	template <class K, class Hasher>
-	bool unordered_set<K, Hasher>::
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	bool unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::
 	        contains(const K& _k) const
 	{
-		return find(_k) != npos;
+		return locate(key_of(_k)).node != bucket_type::npos;
 	}
 
-	template <class K, class Hasher>
-	void unordered_set<K, Hasher>::insert(const K& _k)
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	template <typename Q, class Fn>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::
+	        locate_many(const Q* keys, u64 n, Fn&& fn) const
+	{
+		u64 h[BATCH], idx[BATCH];
+		for (u64 st = 0; st < n; st += BATCH)
+		{
+			const u64 m = nuts::min(BATCH, n - st);
+			for (u64 j = 0; j < m; ++j)
+			{
+				h[j] = hash_fn(keys[st + j]);
+				idx[j] = index_fn(h[j]);
+				__builtin_prefetch(&bucket[idx[j]]);
+			}
+			for (u64 j = 0; j < m; ++j)
+				__builtin_prefetch(bucket[idx[j]].begin().get());
+			for (u64 j = 0; j < m; ++j)
+				fn(st + j, locate(keys[st + j], h[j]));
+		}
+	}
+
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	template <typename Q>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::
+	        find_many(const Q* keys, u64 n, iterator* out) const
+	{
+		locate_many(keys, n, [&](u64 i, const probe& p) {
+			out[i] = p.node == bucket_type::npos ? npos : make_itr(p);
+		});
+	}
+
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	template <typename Q>
+	u64 unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::
+	        contains_many(const Q* keys, u64 n, bool* out) const
+	{
+		u64 res = 0;
+		locate_many(keys, n, [&](u64 i, const probe& p) {
+			res += out[i] = p.node != bucket_type::npos;
+		});
+		return res;
+	}
+
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::insert(const K& _k)
 	{
 		K tmp = _k;
 		insert(nuts::move(tmp));
 	}
 
-	template <class K, class Hasher>
-	void unordered_set<K, Hasher>::insert(K&& _k)
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::insert(K&& _k)
 	{
-		auto it = find(_k);
-		if (it == npos)
+		migrate(migrate_step);
+		auto p = locate(key_of(_k));
+		if (p.node == bucket_type::npos)
 		{
-			if (_size == *bucket_size - 1) rehash();
-			u64 index = get_index(_k);
-			bucket[index].push_back(static_cast<K&&>(_k));
+			bucket[insert_index(p.hash)].emplace_back(p.hash, static_cast<K&&>(_k));
 			++_size;
 		}
 	}
 
-	template <class K, class Hasher>
-	bool unordered_set<K, Hasher>::erase(const K& _k)
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	bool unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::erase(const K& _k)
 	{
-		u64 i = get_index(_k);
-		auto it = nuts::find(bucket[i], _k);
-		if (it == bucket_type::npos)
+		migrate(migrate_step);
+		auto p = locate(key_of(_k));
+		if (p.node == bucket_type::npos)
 			return false;
 		else
 		{
-			bucket[i].erase(it);
+			bucket_of(p).erase(p.node);
 			_size--;
 			return true;
 		}
 	}
 
-	template <class K, class Hasher>
-	void unordered_set<K, Hasher>::clear()
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::clear()
 	{
 		if (!empty())
 		{
 			for_each(bucket, [](bucket_type& x) { x.clear(); });
-			bucket_size = PRIME_LIST;
-			_size = 0;
+			old_bucket.drop();
+			index_fn.reset();
+			_size = migrate_pos = 0;
 		}
 	}
 
-	template <class K, class Hasher>
-	void unordered_set<K, Hasher>::rehash()
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::set_rehash_step(u64 n)
 	{
-		if (bucket_size != PRIME_LIST + 61)
-			bucket_size++;
-		vector<bucket_type> tmp(*bucket_size);
+		migrate_step = n;
+		if (n == 0) migrate(old_bucket.size());
+	}
 
-		auto opr = [&](K& x) {
-			u64 index = get_index(x);
-			tmp[index].push_back(nuts::move(x));
-		};
+	// Moves up to n old buckets into the new array, frees the old one once drained
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::migrate(u64 n)
+	{
+		if (!rehashing()) return;
+		for (; n != 0 && rehashing(); --n, ++migrate_pos)
+			relink(old_bucket[migrate_pos], bucket);
+		if (!rehashing())
+		{
+			old_bucket.drop();
+			migrate_pos = 0;
+		}
+	}
 
-		for_each(*this, opr);
+	// Full table: rehash at once, or swap in a bigger array and drain the old one lazily
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::grow()
+	{
+		if (migrate_step == 0) return rehash();
+
+		migrate(old_bucket.size());// Normally a no-op, insert_index() drains ahead of the grow
+		old_index = index_fn;
+		if (!index_fn.grow()) return;
+		bucket_array tmp(bucket_count());
+		old_bucket.move(bucket);
+		bucket.move(tmp);
+		migrate_pos = 0;
+	}
+
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::rehash()
+	{
+		migrate(old_bucket.size());
+		index_fn.grow();
+		rebuild();
+	}
+
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::rebuild()
+	{
+		bucket_array tmp(bucket_count());
+		for (u64 i = 0; i < bucket.size(); ++i)
+			relink(bucket[i], tmp);
 		bucket.move(tmp);
 	}
 
-	template <class K, class Hasher>
-	void unordered_set<K, Hasher>::print() const
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::reserve(u64 n)
+	{
+		if (static_cast<f64>(n) <= max_load * bucket_count()) return;
+		migrate(old_bucket.size());
+		index_fn.fit(buckets_for(n));
+		rebuild();
+	}
+
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::max_load_factor(f64 ml)
+	{
+		assert(ml > 0);
+		max_load = ml;
+		reserve(_size);
+	}
+
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	template <Forward_Itr Itr>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::insert_range(Itr st, Itr ed)
+	{
+		reserve(_size + count_of(st, ed));
+		for_each(st, ed, [&](const K& x) { insert(x); });
+	}
+
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	template <Forward_Itr Itr>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::
+	        insert_range(unique_keys_t, Itr st, Itr ed)
+	{
+		reserve(_size + count_of(st, ed));
+		migrate(old_bucket.size());
+		for_each(st, ed, [&](const K& x) {
+			const u64 h = hash_fn(key_of(x));
+			bucket[insert_index(h)].emplace_back(h, x);
+			++_size;
+		});
+	}
+
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	hash_stats unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::stats() const
+	{
+		hash_stats res;
+		res.size = _size;
+		res.buckets = bucket_count();
+		auto scan = [&](const bucket_array& arr, u64 st) {
+			for (u64 i = st; i < arr.size(); ++i)
+			{
+				res.add_chain(arr[i].size());
+				res.empty_buckets += arr[i].empty();
+			}
+			res.bytes += arr.capacity() * sizeof(bucket_type);
+		};
+
+		scan(bucket, 0);
+		if (rehashing())
+		{
+			// Drained old buckets are not buckets any more
+			scan(old_bucket, migrate_pos);
+			res.buckets += old_bucket.size() - migrate_pos;
+		}
+		res.bytes += sizeof(*this) + _size * sizeof(typename bucket_type::node);
+		probe_stat.fill(res);
+		return res;
+	}
+
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::print() const
 	{
 		auto pr = [&](const auto& x) {
 			nuts::print(x);
@@ -368,24 +695,24 @@ namespace nuts
 		nuts::println("}");
 	}
 
-	template <class K, class Hasher>
-	void unordered_set<K, Hasher>::print_as_table() const
+	template <class K, class Hasher, Allocator Alloc, BucketIndexer Indexer, class KeyOf>
+	void unordered_set<K, Hasher, Alloc, Indexer, KeyOf>::print_as_table() const
 	{
 		u64 collison = 0;
-		for (u64 n = 0; n < *bucket_size; ++n)
+		for (u64 n = 0; n < bucket_count(); ++n)
 		{
 			if (!bucket[n].empty())
 			{
 				collison += bucket[n].size() - 1;
 				printf("#%lld: ", n);
 				for_each(bucket[n],
-				         [](const auto& x) { nuts::print(x, "->"); });
+				         [](const auto& x) { nuts::print(x.value, "->"); });
 				printf("\n");
 			}
 		}
 		printf("[Buckect: %lld || Collision: %.2lf%% || Average: %.2lf ]\n",
-		       *bucket_size, static_cast<f64>(collison) * 100 / _size,
-		       static_cast<f64>(_size) / *bucket_size);
+		       bucket_count(), static_cast<f64>(collison) * 100 / _size,
+		       static_cast<f64>(_size) / bucket_count());
 	}
 }
 
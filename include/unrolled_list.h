@@ -0,0 +1,630 @@
+#ifndef _NUTS_UNROLLED_LIST_
+#define _NUTS_UNROLLED_LIST_
+
+/** @file unrolled_list
+     *  unrolled_list<T, K>: a doubly linked list of nodes that each pack up to K elements
+     *  Pointers are paid per node, and iteration walks arrays instead of chasing every element
+     *  Appends fill the tail node, a full node splits in half on insert,
+     *  and an erase merges the node with a neighbour when one of them is under half full
+     *  and both fit in one node, so an under-filled node only sits between nodes it can't merge with
+     *  Same interface as list, except insert() and erase() return the iterator they leave behind:
+     *  they shift elements inside a node, which invalidates the iterators into it
+     */
+
+#include <cassert>
+
+#include "algorithm.h"
+#include "iterator.h"
+#include "memory.h"
+#include "move.h"
+#include "node_pool.h"
+#include "type.h"
+
+namespace nuts
+{
+	template <class T, u64 K>
+	struct UnrolledNode// Element block, the elements are buf[first, first + count)
+	{
+		UnrolledNode<T, K>* prev = nullptr;
+		UnrolledNode<T, K>* next = nullptr;
+		u64 first = 0;// Erasing near the front moves it up instead of shifting the rest down
+		u64 count = 0;
+		alignas(T) unsigned char buf[K * sizeof(T)];
+
+		UnrolledNode() = default;
+		~UnrolledNode() { destroy_n(slot(0), count); }
+
+		inline T* slot(u64 i) { return reinterpret_cast<T*>(buf) + first + i; }
+		inline const T* slot(u64 i) const { return reinterpret_cast<const T*>(buf) + first + i; }
+		inline bool full() const { return count == K; }
+
+		// Moves the elements down to buf[0] unless n more fit behind them
+		void reserve_back(u64 n)
+		{
+			if (first == 0 || first + count + n <= K) return;
+			T* dst = reinterpret_cast<T*>(buf);
+			if constexpr (is_trivially_relocatable_v<T>)
+				memmove(dst, slot(0), count * sizeof(T));
+			else
+				for (u64 j = 0; j < count; ++j)
+				{
+					(void) *new (dst + j) T(nuts::move(*slot(j)));
+					slot(j)->~T();
+				}
+			first = 0;
+		}
+
+		// Open an uninitialized hole at i
+		void shift_right(u64 i)
+		{
+			reserve_back(1);
+			if constexpr (is_trivially_relocatable_v<T>)
+				memmove(slot(i + 1), slot(i), (count - i) * sizeof(T));
+			else
+				for (u64 j = count; j > i; --j)
+				{
+					(void) *new (slot(j)) T(nuts::move(*slot(j - 1)));
+					slot(j - 1)->~T();
+				}
+		}
+
+		// Destroy the element at i, then close the hole from the shorter side
+		void erase_at(u64 i)
+		{
+			slot(i)->~T();
+			if (i < count / 2)
+			{
+				if constexpr (is_trivially_relocatable_v<T>)
+					memmove(slot(1), slot(0), i * sizeof(T));
+				else
+					for (u64 j = i; j > 0; --j)
+					{
+						(void) *new (slot(j)) T(nuts::move(*slot(j - 1)));
+						slot(j - 1)->~T();
+					}
+				++first;
+			}
+			else
+			{
+				if constexpr (is_trivially_relocatable_v<T>)
+					memmove(slot(i), slot(i + 1), (count - i - 1) * sizeof(T));
+				else
+					for (u64 j = i; j + 1 < count; ++j)
+					{
+						(void) *new (slot(j)) T(nuts::move(*slot(j + 1)));
+						slot(j + 1)->~T();
+					}
+			}
+			if (--count == 0) first = 0;
+		}
+	};
+
+	template <class T, u64 K = (sizeof(T) < 32 ? 256 / sizeof(T) : 8), Allocator Alloc = allocator<T>>
+	class unrolled_list// Manager class
+	{
+		static_assert(K >= 2, "A node must hold at least two elements!");
+
+	public:
+		using value_type = T;
+		using node = UnrolledNode<T, K>;
+		using node_ptr = node*;
+		using allocator_type = Alloc;
+		using node_allocator = node_alloc_t<Alloc, node>;
+		using self_type = unrolled_list<T, K, Alloc>;
+
+		static constexpr u64 node_capacity = K;
+
+	private:
+		static constexpr u64 MIN_FILL = K / 2;
+
+		node_ptr new_node_after(node_ptr pos);// Empty node after pos, at the front if pos is nullptr
+		void free_node(node_ptr p);
+		void split(node_ptr p);    // Move the upper half of a full node into a new next node
+		void absorb(node_ptr dst, node_ptr src);// Append src's elements to dst and free src
+
+	public:
+		unrolled_list() = default;                            // Void constructor
+		explicit unrolled_list(const Alloc& a) : alloc(a) {}  // Init by an allocator
+		unrolled_list(const T& userInputData, u64 userInputlength = 1);// Init by several valued elements
+		unrolled_list(const self_type& obj);                  // Init by another list(deep copy)
+		unrolled_list(self_type&& src) { move(src); }
+		unrolled_list(const std::initializer_list<T>& ilist);// Init by a {ilist}
+		~unrolled_list() { clear(); }
+
+		inline Alloc get_allocator() const
+		{
+			if constexpr (requires { Alloc(alloc); })
+				return Alloc(alloc);
+			else
+				return Alloc();// Pooled nodes of the default allocator
+		}
+
+		inline bool empty() const { return length == 0; }
+		inline u64 size() const { return length; }
+		inline u64 node_count() const { return nodes; }
+		node_ptr data() const { return head; }
+		void print() const;
+		self_type& clear();
+
+		self_type& operator=(const self_type& obj);
+		self_type& operator=(self_type&& src) { return move(src); }
+		self_type& move(self_type& src);
+
+		template <typename... Args>
+		self_type& emplace_back(Args&&... args);
+		self_type& push_back(const T& obj, u64 num = 1);
+		self_type& push_back(T&& obj);
+
+		template <typename... Args>
+		self_type& emplace_front(Args&&... args);
+		self_type& push_front(const T& obj, u64 num = 1);
+		self_type& push_front(T&& obj);
+
+		self_type& pop_back();
+		self_type& pop_front();
+
+		class iterator
+		    : public bidirectional_iterator
+		{
+		public:
+			using value_type = T;
+
+		protected:
+			node_ptr _ptr = nullptr;
+			u64 idx = 0;
+
+		public:
+			iterator() = default;
+			iterator(node_ptr p, u64 i) : _ptr(p), idx(i) {}
+			iterator(const iterator& obj) = default;
+
+			node_ptr get() const { return _ptr; }
+			u64 index() const { return idx; }
+
+			T& operator*() const { return *_ptr->slot(idx); }
+			T* operator->() const { return _ptr->slot(idx); }
+
+			iterator& operator=(const iterator& obj) = default;
+
+			inline bool operator==(const iterator& obj) const
+			{
+				return _ptr == obj._ptr && idx == obj.idx;
+			}
+			inline bool operator!=(const iterator& obj) const { return !(*this == obj); }
+
+			iterator& operator++()
+			{
+				if (_ptr == nullptr) return *this;
+				if (++idx == _ptr->count)
+					_ptr = _ptr->next, idx = 0;
+				return *this;
+			}
+
+			iterator operator++(int)
+			{
+				iterator res = *this;
+				++(*this);
+				return res;
+			}
+
+			iterator& operator--()
+			{
+				if (_ptr == nullptr) return *this;
+				if (idx != 0)
+					--idx;
+				else if ((_ptr = _ptr->prev) != nullptr)
+					idx = _ptr->count - 1;
+				return *this;
+			}
+
+			iterator operator--(int)
+			{
+				iterator res = *this;
+				--(*this);
+				return res;
+			}
+
+			iterator operator+(i64 bias) const
+			{
+				iterator res = *this;
+				return nuts::advance(res, bias);
+			}
+
+			void operator+=(i64 bias) { *this = nuts::advance(*this, bias); }
+
+			iterator operator-(i64 bias) const
+			{
+				iterator res = *this;
+				return nuts::advance(res, -bias);
+			}
+
+			void operator-=(i64 bias) { *this = nuts::advance(*this, -bias); }
+		};
+
+		static constexpr iterator npos {};
+
+		inline iterator begin() const { return head != nullptr ? iterator(head, 0) : npos; }
+		inline iterator end() const { return tail != nullptr ? iterator(tail, tail->count - 1) : npos; }
+
+		inline T& front() { return *head->slot(0); }
+		inline T& back() { return *tail->slot(tail->count - 1); }
+
+		inline const T& front() const { return *head->slot(0); }
+		inline const T& back() const { return *tail->slot(tail->count - 1); }
+
+		template <typename... Args>
+		iterator emplace(const iterator& pos, Args&&... args);// Build an element after pos, at the front if pos is npos
+		iterator insert(const iterator& pos, const T& obj);   // Returns the new element
+		iterator insert(const iterator& pos, T&& obj);
+		iterator erase(const iterator& pos);// Returns the element after the erased one, or npos
+
+		template <typename Func>
+		iterator find(Func fn) const;// Find the first element match the condition
+
+		template <typename Func>
+		void erase_all(const Func& fn);// Remove all elements match the condition
+
+		template <Forward_Itr Itr>
+		void assign(Itr st, Itr ed);
+
+		template <Forward_Itr Itr>
+		unrolled_list(Itr st, Itr ed);
+
+	protected:
+		// Build an element at i of p, splitting p if full, args must not name an element of p
+		template <typename... Args>
+		iterator emplace_at(node_ptr p, u64 i, Args&&... args);
+
+		node_ptr head = nullptr;
+		node_ptr tail = nullptr;
+		u64 length = 0;
+		u64 nodes = 0;
+		[[no_unique_address]] node_allocator alloc;
+	};
+
+	// Deduction Guide
+	template <class T>
+	unrolled_list(const std::initializer_list<T>&) -> unrolled_list<T>;
+
+	// Nodes never point back to the manager
+	template <class T, u64 K, Allocator Alloc>
+	struct is_trivially_relocatable<unrolled_list<T, K, Alloc>>
+	{
+		static constexpr bool value = true;
+	};
+
+	template <class T, u64 K, Allocator Alloc>
+	unrolled_list<T, K, Alloc>::unrolled_list(const T& userInputData, u64 userInputlength)
+	{
+		push_back(userInputData, userInputlength);
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	template <Forward_Itr Itr>
+	unrolled_list<T, K, Alloc>::unrolled_list(Itr st, Itr ed)
+	{
+		assign(st, ed);
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	unrolled_list<T, K, Alloc>::unrolled_list(const self_type& obj)
+	    : alloc(obj.alloc)
+	{
+		if (!obj.empty()) this->operator=(obj);
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	unrolled_list<T, K, Alloc>::unrolled_list(const std::initializer_list<T>& ilist)
+	{
+		for (const auto& x: ilist) push_back(x);
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	unrolled_list<T, K, Alloc>& unrolled_list<T, K, Alloc>::operator=(const self_type& obj)
+	{
+		if (&obj == this) return *this;
+		clear();
+		for (node_ptr p = obj.head; p != nullptr; p = p->next)
+			for (u64 i = 0; i < p->count; ++i) push_back(*p->slot(i));
+		return *this;
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	unrolled_list<T, K, Alloc>& unrolled_list<T, K, Alloc>::move(self_type& src)
+	{
+		if (&src == this) return *this;
+		clear();
+		alloc = src.alloc;
+		head = src.head, tail = src.tail;
+		length = src.length, nodes = src.nodes;
+		src.head = src.tail = nullptr;
+		src.length = src.nodes = 0;
+		return *this;
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	typename unrolled_list<T, K, Alloc>::node_ptr
+	unrolled_list<T, K, Alloc>::new_node_after(node_ptr pos)
+	{
+		node_ptr p = alloc_new(alloc);
+		p->prev = pos;
+		p->next = pos != nullptr ? pos->next : head;
+		if (p->next != nullptr)
+			p->next->prev = p;
+		else
+			tail = p;
+		if (pos != nullptr)
+			pos->next = p;
+		else
+			head = p;
+		nodes++;
+		return p;
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	void unrolled_list<T, K, Alloc>::free_node(node_ptr p)
+	{
+		if (p->prev != nullptr)
+			p->prev->next = p->next;
+		else
+			head = p->next;
+		if (p->next != nullptr)
+			p->next->prev = p->prev;
+		else
+			tail = p->prev;
+		alloc_delete(alloc, p);
+		nodes--;
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	void unrolled_list<T, K, Alloc>::split(node_ptr p)
+	{
+		node_ptr q = new_node_after(p);
+		const u64 keep = K - K / 2;
+		relocate_n(p->slot(keep), p->count - keep, q->slot(0));
+		q->count = p->count - keep;
+		p->count = keep;
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	void unrolled_list<T, K, Alloc>::absorb(node_ptr dst, node_ptr src)
+	{
+		dst->reserve_back(src->count);
+		relocate_n(src->slot(0), src->count, dst->slot(dst->count));
+		dst->count += src->count;
+		src->count = 0;
+		free_node(src);
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	unrolled_list<T, K, Alloc>& unrolled_list<T, K, Alloc>::clear()
+	{
+		while (head != nullptr) free_node(head);
+		length = 0;
+		return *this;
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	template <typename... Args>
+	unrolled_list<T, K, Alloc>& unrolled_list<T, K, Alloc>::emplace_back(Args&&... args)
+	{
+		// Appending fills the tail node completely instead of splitting it
+		if (tail == nullptr || tail->full())
+			new_node_after(tail);
+		else if (tail->first + tail->count == K)
+		{
+			// args may name an element reserve_back() moves
+			T tmp(static_cast<Args&&>(args)...);
+			tail->reserve_back(1);
+			(void) *new (tail->slot(tail->count)) T(nuts::move(tmp));
+			tail->count++;
+			length++;
+			return *this;
+		}
+		(void) *new (tail->slot(tail->count)) T(static_cast<Args&&>(args)...);
+		tail->count++;
+		length++;
+		return *this;
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	unrolled_list<T, K, Alloc>& unrolled_list<T, K, Alloc>::push_back(const T& obj, u64 num)
+	{
+		for (u64 i = 0; i < num; ++i) emplace_back(obj);
+		return *this;
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	unrolled_list<T, K, Alloc>& unrolled_list<T, K, Alloc>::push_back(T&& obj)
+	{
+		return emplace_back(nuts::move(obj));
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	template <typename... Args>
+	unrolled_list<T, K, Alloc>& unrolled_list<T, K, Alloc>::emplace_front(Args&&... args)
+	{
+		// A new head fills from its back end, so the pushes after it only move first down
+		if (head == nullptr || head->full()) new_node_after(nullptr)->first = K;
+		if (head->first != 0)
+			--head->first;
+		else
+		{
+			// args may name an element shift_right() moves
+			T tmp(static_cast<Args&&>(args)...);
+			head->shift_right(0);
+			(void) *new (head->slot(0)) T(nuts::move(tmp));
+			head->count++;
+			length++;
+			return *this;
+		}
+		(void) *new (head->slot(0)) T(static_cast<Args&&>(args)...);
+		head->count++;
+		length++;
+		return *this;
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	unrolled_list<T, K, Alloc>& unrolled_list<T, K, Alloc>::push_front(const T& obj, u64 num)
+	{
+		for (u64 i = 0; i < num; ++i) emplace_front(obj);
+		return *this;
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	unrolled_list<T, K, Alloc>& unrolled_list<T, K, Alloc>::push_front(T&& obj)
+	{
+		return emplace_front(nuts::move(obj));
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	unrolled_list<T, K, Alloc>& unrolled_list<T, K, Alloc>::pop_back()
+	{
+		if (empty()) return *this;
+		tail->erase_at(tail->count - 1);
+		length--;
+		if (tail->count == 0) free_node(tail);
+		return *this;
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	unrolled_list<T, K, Alloc>& unrolled_list<T, K, Alloc>::pop_front()
+	{
+		if (empty()) return *this;
+		erase(begin());
+		return *this;
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	template <typename... Args>
+	typename unrolled_list<T, K, Alloc>::iterator
+	unrolled_list<T, K, Alloc>::emplace(const iterator& pos, Args&&... args)
+	{
+		if (pos == npos)
+		{
+			emplace_front(static_cast<Args&&>(args)...);
+			return begin();
+		}
+
+		node_ptr p = pos.get();
+		u64 i = pos.index() + 1;
+		if (i != p->count || p->first + p->count == K)
+		{
+			// args may name an element split() or shift_right() moves
+			T tmp(static_cast<Args&&>(args)...);
+			return emplace_at(p, i, nuts::move(tmp));
+		}
+		return emplace_at(p, i, static_cast<Args&&>(args)...);
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	template <typename... Args>
+	typename unrolled_list<T, K, Alloc>::iterator
+	unrolled_list<T, K, Alloc>::emplace_at(node_ptr p, u64 i, Args&&... args)
+	{
+		if (p->full())
+		{
+			split(p);
+			if (i > p->count) i -= p->count, p = p->next;
+		}
+		p->shift_right(i);
+		(void) *new (p->slot(i)) T(static_cast<Args&&>(args)...);
+		p->count++;
+		length++;
+		return iterator(p, i);
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	typename unrolled_list<T, K, Alloc>::iterator
+	unrolled_list<T, K, Alloc>::insert(const iterator& pos, const T& obj)
+	{
+		return emplace(pos, obj);
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	typename unrolled_list<T, K, Alloc>::iterator
+	unrolled_list<T, K, Alloc>::insert(const iterator& pos, T&& obj)
+	{
+		return emplace(pos, nuts::move(obj));
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	typename unrolled_list<T, K, Alloc>::iterator
+	unrolled_list<T, K, Alloc>::erase(const iterator& pos)
+	{
+		node_ptr p = pos.get();
+		u64 i = pos.index();
+		p->erase_at(i);
+		length--;
+
+		if (p->count == 0)
+		{
+			node_ptr nxt = p->next;
+			free_node(p);
+			return nxt != nullptr ? iterator(nxt, 0) : npos;
+		}
+
+		// Slot i of p now holds the element after the erased one
+		auto mergeable = [](node_ptr x, node_ptr y) {
+			return y != nullptr && (x->count < MIN_FILL || y->count < MIN_FILL) &&
+			       x->count + y->count <= K;
+		};
+		if (mergeable(p, p->next))
+			absorb(p, p->next);
+		else if (mergeable(p, p->prev))
+		{
+			node_ptr r = p->prev;
+			i += r->count;
+			absorb(r, p);
+			p = r;
+		}
+		if (i < p->count) return iterator(p, i);
+		return p->next != nullptr ? iterator(p->next, 0) : npos;
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	template <typename Func>
+	typename unrolled_list<T, K, Alloc>::iterator
+	unrolled_list<T, K, Alloc>::find(Func fn) const
+	{
+		for (node_ptr p = head; p != nullptr; p = p->next)
+			for (u64 i = 0; i < p->count; ++i)
+				if (fn(*p->slot(i))) return iterator(p, i);
+		return npos;
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	template <typename Func>
+	void unrolled_list<T, K, Alloc>::erase_all(const Func& fn)
+	{
+		for (auto it = begin(); it != npos;)
+		{
+			if (fn(*it))
+				it = erase(it);
+			else
+				++it;
+		}
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	template <Forward_Itr Itr>
+	void unrolled_list<T, K, Alloc>::assign(Itr st, Itr ed)
+	{
+		for_each(st, ed, [&](const auto& x) { push_back(x); });
+	}
+
+	template <class T, u64 K, Allocator Alloc>
+	void unrolled_list<T, K, Alloc>::print() const
+	{
+		printf("unrolled_list @%#llx = [", (u64) data());
+		for (node_ptr p = head; p != nullptr; p = p->next)
+			for (u64 i = 0; i < p->count; ++i)
+			{
+				nuts::print(*p->slot(i));
+				if (p != tail || i + 1 != p->count) printf(", ");
+			}
+		printf("]\n");
+	}
+}
+
+#endif
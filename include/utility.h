@@ -23,7 +23,14 @@ namespace nuts
 		pair(const T1& _first, const T2& _last)
 		    : first(_first), second(_last) {}
 
-		pair(pair<T1, T2>&& src) noexcept { move(src); }
+		// first from _first, second built in place from args
+		template <typename U, typename... Args>
+		pair(in_place_t, U&& _first, Args&&... args)
+		    : first(static_cast<U&&>(_first)),
+		      second(static_cast<Args&&>(args)...) {}
+
+		pair(pair<T1, T2>&& src) noexcept
+		    : first(nuts::move(src.first)), second(nuts::move(src.second)) {}
 
 		inline T1& get_first() { return first; }
 		inline T2& get_second() { return second; }
@@ -93,6 +100,16 @@ namespace nuts
 	template <class T1, class T2>
 	pair(T1, T2) -> pair<T1, T2>;
 
+	// Extract the key of a pair, used by associative containers
+	template <class P>
+	struct select_first
+	{
+		using type = typename P::first_type;
+
+		inline constexpr const type&
+		operator()(const P& p) const noexcept { return p.first; }
+	};
+
 	template <class T1, class T2>
 	inline auto
 	make_pair(const T1& _first, const T2& _second)
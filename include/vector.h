@@ -7,6 +7,7 @@
 
 #include "algorithm.h"
 #include "iterator.h"
+#include "memory.h"
 #include "type.h"
 
 #ifndef STD_EXPAN
@@ -19,34 +20,38 @@
 
 namespace nuts
 {
-	template <class T>
+	template <class T, Allocator Alloc = allocator<T>>
 	class vector
 	{
 	public:
 		using value_type = T;
 		using pointer = T*;
 		using iterator = pointer;
+		using allocator_type = Alloc;
 
 		vector() = default;                                        // Void constructor
+		explicit vector(const Alloc& a) : alloc(a) {}              // Init by an allocator
 		explicit vector(u64 userInputSize);                        // Init by size
 		explicit vector(u64 userInputSize, const T& userInputData);// Init by size and value
-		vector(const vector<T>& obj);                              // Copy constructor
-		vector(vector<T>&& src) noexcept { move(src); }            // Move constructor
+		vector(const vector<T, Alloc>& obj);                       // Copy constructor
+		vector(vector<T, Alloc>&& src) noexcept { move(src); }     // Move constructor
 		vector(const std::initializer_list<T>& ilist);             // Init by a {ilist}
 		~vector() noexcept { drop(); }
 
+		inline Alloc get_allocator() const noexcept { return alloc; }
+
 		inline T* data() const noexcept { return const_cast<T*>(data_ptr); }
 		inline u64 size() const noexcept { return v_size; }               // Return the number of elements
 		inline u64 capacity() const noexcept { return v_capacity; }       // Return the current capacity
 		inline bool empty() const noexcept { return v_size == 0; }        // Check whether the vector is empty
 		inline bool exist() const noexcept { return data_ptr != nullptr; }// Check whether the vector is existed
 
-		vector<T>& shrink_to_fit();// Reduce memory usage by freeing unused memory
-		vector<T>& resize(u64 N);  // Reduce or expand size
-		vector<T>& reserve(u64 N) { return (N <= v_capacity) ? *this : resize(N); }
-		vector<T>& expand();
+		vector<T, Alloc>& shrink_to_fit();// Reduce memory usage by freeing unused memory
+		vector<T, Alloc>& resize(u64 N);  // Reduce or expand size
+		vector<T, Alloc>& reserve(u64 N) { return (N <= v_capacity) ? *this : resize(N); }
+		vector<T, Alloc>& expand();
 
-		inline void clear();// Clear all values, but don't destroy
+		inline void clear();// Destroy all values, but keep the memory
 		void drop();        // Clear the contents and release memory, contain exist()
 		void print() const;
 
@@ -56,8 +61,8 @@ namespace nuts
 		void emplace_back(const T& val);
 		void emplace_back(T&& val);
 
-		inline void pop_back();                  // Remove the last element
-		vector<T>& move(vector<T>& src) noexcept;// Deprive other's ownership
+		inline void pop_back();                                // Remove the last element
+		vector<T, Alloc>& move(vector<T, Alloc>& src) noexcept;// Deprive other's ownership
 
 		inline T& operator[](u64 N) noexcept;// Access specified element
 		inline const T& operator[](u64 N) const noexcept;
@@ -65,8 +70,8 @@ namespace nuts
 		inline T& at(u64 N) noexcept;
 		inline const T& at(u64 N) const noexcept;
 
-		vector<T>& operator=(const vector<T>& obj);// Deep copy operator
-		inline vector<T>& operator=(vector<T>&& src) { return move(src); }
+		vector<T, Alloc>& operator=(const vector<T, Alloc>& obj);// Deep copy operator
+		inline vector<T, Alloc>& operator=(vector<T, Alloc>&& src) { return move(src); }
 
 		inline iterator begin() const { return data(); }
 		inline iterator end() const
@@ -87,9 +92,13 @@ namespace nuts
 		template <Forward_Itr Itr>
 		vector(Itr st, Itr ed);
 
+	private:
+		void reallocate(u64 N);// Move elements into storage of exactly N slots
+
 	protected:
 		pointer data_ptr = nullptr;
 		u64 v_size = 0, v_capacity = 0;
+		[[no_unique_address]] Alloc alloc;
 	};
 
 	// Deduction Guide
@@ -99,96 +108,122 @@ namespace nuts
 	template <Forward_Itr Itr>
 	vector(Itr st, Itr ed) -> vector<typename Itr::value_type>;
 
-	template <class T>
-	vector<T>::vector(u64 userInputSize)
+	// Only owns a pointer to heap storage
+	template <class T, Allocator Alloc>
+	struct is_trivially_relocatable<vector<T, Alloc>>
+	{
+		static constexpr bool value = true;
+	};
+
+	template <class T, Allocator Alloc>
+	vector<T, Alloc>::vector(u64 userInputSize)
 	{
-		data_ptr = new T[userInputSize];
+		data_ptr = alloc.allocate(userInputSize);
+		for (u64 i = 0; i < userInputSize; i++)
+			(void) *new (data_ptr + i) T();
 		v_size = userInputSize;
 		v_capacity = v_size;
 	}
 
-	template <class T>
-	vector<T>::vector(u64 userInputSize, const T& userInputData)
+	template <class T, Allocator Alloc>
+	vector<T, Alloc>::vector(u64 userInputSize, const T& userInputData)
 	{
-		data_ptr = new T[userInputSize];
-		nuts::fill_n(data_ptr, userInputSize, userInputData);
+		data_ptr = alloc.allocate(userInputSize);
+		uninitialized_fill_n(data_ptr, userInputSize, userInputData);
 		v_size = userInputSize;
 		v_capacity = v_size;
 	}
 
-	template <class T>
-	vector<T>::vector(const vector<T>& obj)
+	template <class T, Allocator Alloc>
+	vector<T, Alloc>::vector(const vector<T, Alloc>& obj)
+	    : alloc(obj.alloc)
 	{
-		data_ptr = new T[obj.size() + STD_EXPAN];
+		data_ptr = alloc.allocate(obj.size() + STD_EXPAN);
 		v_size = obj.size();
 		v_capacity = v_size + STD_EXPAN;
-		memcpy(data_ptr, obj.data(), sizeof(T) * obj.size());
+		uninitialized_copy_n(obj.data(), obj.size(), data_ptr);
 	}
 
-	template <class T>
-	vector<T>::vector(const std::initializer_list<T>& ilist)
+	template <class T, Allocator Alloc>
+	vector<T, Alloc>::vector(const std::initializer_list<T>& ilist)
 	{
 		reserve(ilist.size() + STD_EXPAN);
 		for (const T& x: ilist) push_back(x);
 	}
 
-	template <class T>
+	template <class T, Allocator Alloc>
 	template <Forward_Itr Itr>
-	vector<T>::vector(Itr st, Itr ed)
+	vector<T, Alloc>::vector(Itr st, Itr ed)
 	{
 		assign(st, ed);
 	}
 
-	template <class T>
-	inline void vector<T>::clear()
+	template <class T, Allocator Alloc>
+	inline void vector<T, Alloc>::clear()
 	{
-		if (!empty()) v_size = 0;
+		destroy_n(data_ptr, v_size);
+		v_size = 0;
 	}
 
-	template <class T>
-	void vector<T>::drop()
+	template <class T, Allocator Alloc>
+	void vector<T, Alloc>::drop()
 	{
 		if (exist())
 		{
-			delete[] data_ptr;
+			destroy_n(data_ptr, v_size);
+			alloc.deallocate(data_ptr, v_capacity);
 			data_ptr = nullptr;
 		}
+		v_size = v_capacity = 0;
 	}
 
-	template <class T>
-	vector<T>& vector<T>::shrink_to_fit()
+	template <class T, Allocator Alloc>
+	void vector<T, Alloc>::reallocate(u64 N)
 	{
-		if (v_capacity > v_size)
+		// Trivially relocatable types go through realloc(), others are moved one by one
+		if constexpr (Reallocator<Alloc>)
+			data_ptr = alloc.reallocate(data_ptr, v_size, N);
+		else
 		{
-			T* tmp = new T[v_size];
-			for (u64 i = 0; i < v_size; i++)
-				tmp[i] = nuts::move(data_ptr[i]);
-			delete[] data_ptr;
+			T* tmp = alloc.allocate(N);
+			if (exist())
+			{
+				relocate_n(data_ptr, v_size, tmp);
+				alloc.deallocate(data_ptr, v_capacity);
+			}
 			data_ptr = tmp;
-			v_capacity = v_size;
 		}
-		return *this;
+		v_capacity = N;
 	}
 
-	template <class T>
-	vector<T>& vector<T>::resize(u64 N)
+	template <class T, Allocator Alloc>
+	vector<T, Alloc>& vector<T, Alloc>::shrink_to_fit()
 	{
-		if (N > v_size)
+		if (v_capacity > v_size)
 		{
-			T* tmp = new T[N];
-			for (u64 i = 0; i < v_size; i++)
-				tmp[i] = nuts::move(data_ptr[i]);
-			delete[] data_ptr;
-			data_ptr = tmp;
-			v_capacity = N;
+			if (v_size == 0)
+				drop();
+			else
+				reallocate(v_size);
 		}
+		return *this;
+	}
+
+	template <class T, Allocator Alloc>
+	vector<T, Alloc>& vector<T, Alloc>::resize(u64 N)
+	{
+		if (N > v_size)
+			reallocate(N);
 		if (N < v_size)
+		{
+			destroy_n(data_ptr + N, v_size - N);
 			v_size = N;
+		}
 		return *this;
 	}
 
-	template <class T>
-	vector<T>& vector<T>::expand()
+	template <class T, Allocator Alloc>
+	vector<T, Alloc>& vector<T, Alloc>::expand()
 	{
 		if (v_size != 0)
 			reserve(v_size * EXPAN_COEF);
@@ -197,54 +232,61 @@ namespace nuts
 		return *this;
 	}
 
-	template <class T>
-	void vector<T>::emplace_back()
+	template <class T, Allocator Alloc>
+	void vector<T, Alloc>::emplace_back()
 	{
 		if (v_capacity == v_size)
 			expand();
 		(void) *new (data_ptr + v_size++) T();
 	}
 
-	template <class T>
-	void vector<T>::emplace_back(T&& val)
+	template <class T, Allocator Alloc>
+	void vector<T, Alloc>::emplace_back(T&& val)
 	{
 		if (v_capacity == v_size)
 			expand();
 		(void) *new (data_ptr + v_size++) T(nuts::move(val));
 	}
 
-	template <class T>
-	void vector<T>::emplace_back(const T& val)
+	template <class T, Allocator Alloc>
+	void vector<T, Alloc>::emplace_back(const T& val)
 	{
 		if (v_capacity == v_size)
+		{
+			// val may live in the storage being relocated
+			T tmp(val);
 			expand();
+			(void) *new (data_ptr + v_size++) T(nuts::move(tmp));
+			return;
+		}
 		(void) *new (data_ptr + v_size++) T(val);
 	}
 
-	template <class T>
-	void vector<T>::push_back(const T& src)
+	template <class T, Allocator Alloc>
+	void vector<T, Alloc>::push_back(const T& src)
 	{
 		emplace_back(src);
 	}
 
-	template <class T>
-	void vector<T>::push_back(T&& src)
+	template <class T, Allocator Alloc>
+	void vector<T, Alloc>::push_back(T&& src)
 	{
 		emplace_back(nuts::move(src));
 	}
 
-	template <class T>
-	inline void vector<T>::pop_back()
+	template <class T, Allocator Alloc>
+	inline void vector<T, Alloc>::pop_back()
 	{
 		if (!empty())
-			--v_size;
+			data_ptr[--v_size].~T();
 	}
 
-	template <class T>
-	vector<T>& vector<T>::move(vector<T>& src) noexcept
+	template <class T, Allocator Alloc>
+	vector<T, Alloc>& vector<T, Alloc>::move(vector<T, Alloc>& src) noexcept
 	{
 		drop();// Self destroy
 
+		alloc = src.alloc;      // Storage goes back to where it came from
 		data_ptr = src.data_ptr;// Pass ownership
 		v_size = src.v_size;
 		v_capacity = src.v_capacity;
@@ -255,44 +297,47 @@ namespace nuts
 		return *this;
 	}
 
-	template <class T>
-	inline T& vector<T>::operator[](const u64 N) noexcept
+	template <class T, Allocator Alloc>
+	inline T& vector<T, Alloc>::operator[](const u64 N) noexcept
 	{
 		// assert(N < v_capacity);
 		return data_ptr[N];
 	}
 
-	template <class T>
-	inline const T& vector<T>::operator[](const u64 N) const noexcept
+	template <class T, Allocator Alloc>
+	inline const T& vector<T, Alloc>::operator[](const u64 N) const noexcept
 	{
 		assert(N < v_size);
 		return data_ptr[N];
 	}
 
-	template <class T>
-	inline T& vector<T>::at(const u64 N) noexcept
+	template <class T, Allocator Alloc>
+	inline T& vector<T, Alloc>::at(const u64 N) noexcept
 	{
 		assert(N < v_capacity);
 		return data_ptr[N];
 	}
 
-	template <class T>
-	inline const T& vector<T>::at(const u64 N) const noexcept
+	template <class T, Allocator Alloc>
+	inline const T& vector<T, Alloc>::at(const u64 N) const noexcept
 	{
 		// assert(N < v_size);
 		return data_ptr[N];
 	}
 
-	template <class T>
-	vector<T>& vector<T>::operator=(const vector<T>& obj)
+	template <class T, Allocator Alloc>
+	vector<T, Alloc>& vector<T, Alloc>::operator=(const vector<T, Alloc>& obj)
 	{
-		drop();
-		assign(obj.begin(), obj.end());
+		if (this == &obj) return *this;
+		clear();
+		reserve(obj.size());
+		uninitialized_copy_n(obj.data(), obj.size(), data_ptr);
+		v_size = obj.size();
 		return *this;
 	}
 
-	template <class T>
-	void vector<T>::print() const
+	template <class T, Allocator Alloc>
+	void vector<T, Alloc>::print() const
 	{
 		auto print = [&](const auto& x) {
 			nuts::print(x);
@@ -304,9 +349,9 @@ namespace nuts
 		printf("]\n");
 	}
 
-	template <class T>
+	template <class T, Allocator Alloc>
 	template <Forward_Itr Itr>
-	void vector<T>::assign(Itr st, Itr ed)
+	void vector<T, Alloc>::assign(Itr st, Itr ed)
 	{
 		for_each(st, ed, [&](const auto& x) { push_back(x); });
 	}
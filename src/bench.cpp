@@ -0,0 +1,481 @@
+// nuts_bench: every nuts container against its std counterpart
+//   Usage: nuts_bench [max_n] [out_prefix]
+//   n runs over 10, 100, ..., max_n (default 1e7)
+//   Results go to stdout, <out_prefix>.json and <out_prefix>.csv (default nuts_bench)
+
+#include <bits/stdc++.h>
+#include "../nanobench/src/include/nanobench.h"
+#include "../include/bits.h"
+#include "../include/concurrent_hash_map.h"
+
+namespace nb = ankerl::nanobench;
+
+namespace
+{
+	using nuts::u64;
+
+	// Big inputs get a few single-shot epochs, or the suite takes hours
+	void tune(nb::Bench& bench, u64 n)
+	{
+		bench.complexityN(n);
+		if (n >= 100000U)
+			bench.epochs(3).epochIterations(1);
+		else
+			bench.epochs(11).epochIterations(0);
+	}
+
+	std::vector<u64> make_keys(u64 n, nb::Rng& rng)
+	{
+		std::vector<u64> keys(n);
+		for (auto& k: keys) k = rng();
+		return keys;
+	}
+
+	// std boxes iterate [begin, end), nuts ones [begin, end]
+	template <class Box>
+	concept Std_Box = requires { typename Box::iterator::iterator_category; };
+
+	// Maps insert through operator[] and iterate over pairs
+	template <class Box>
+	concept Keyed = requires(Box& box, u64 k) { box[k] = k; };
+
+	template <class Box>
+	u64 sum_of(const Box& box)
+	{
+		u64 res = 0;
+		if constexpr (Std_Box<Box>)
+			for (const auto& x: box) res += x;
+		else
+			nuts::for_each(box, [&](const auto& x) { res += x; });
+		return res;
+	}
+
+	template <class Box>
+	u64 key_sum_of(const Box& box)
+	{
+		u64 res = 0;
+		if constexpr (Std_Box<Box>)
+			for (const auto& x: box) res += x.first;
+		else
+			nuts::for_each(box, [&](const auto& x) { res += x.first; });
+		return res;
+	}
+
+	// vector, deque, list: push_back / index / pop_back / iterate / copy
+	template <class Nuts, class Std>
+	void sequence(nb::Bench& bench, const char* name,
+	              u64 n, const std::vector<u64>& keys)
+	{
+		const auto one = [&]<class Box>(std::string tag) {
+			Box box;
+			for (u64 i = 0; i < n; ++i) box.push_back(keys[i]);
+
+			bench.run(tag + " push_back", [&] {
+				Box tmp;
+				for (u64 i = 0; i < n; ++i) tmp.push_back(keys[i]);
+				nb::doNotOptimizeAway(tmp.back());
+			});
+
+			if constexpr (requires { box[0]; }) {
+				bench.run(tag + " operator[]", [&] {
+					u64 res = 0;
+					for (u64 i = 0; i < n; ++i) res += box[keys[i] % n];
+					nb::doNotOptimizeAway(res);
+				});
+			} else {
+				// Linear lookups, a handful is enough to see the trend
+				bench.run(tag + " find x16", [&] {
+					u64 res = 0;
+					for (u64 i = 0; i < 16; ++i) {
+						const u64 key = keys[keys[i % n] % n];
+						if constexpr (Std_Box<Box>)
+							res += std::find(box.begin(), box.end(), key) != box.end();
+						else
+							res += nuts::find(box, key) != nuts::next(box.end());
+					}
+					nb::doNotOptimizeAway(res);
+				});
+			}
+
+			bench.run(tag + " push_back+pop_back", [&] {
+				Box tmp;
+				for (u64 i = 0; i < n; ++i) tmp.push_back(keys[i]);
+				while (!tmp.empty()) tmp.pop_back();
+				nb::doNotOptimizeAway(tmp.empty());
+			});
+
+			bench.run(tag + " iterate", [&] { nb::doNotOptimizeAway(sum_of(box)); });
+
+			bench.run(tag + " copy", [&] {
+				Box tmp(box);
+				nb::doNotOptimizeAway(tmp.back());
+			});
+		};
+
+		bench.title(name);
+		one.template operator()<Nuts>(std::string("nuts::") + name);
+		one.template operator()<Std>(std::string("std::") + name);
+	}
+
+	// stack, queue: push / push+pop / copy, adaptors have nothing to look up
+	template <class Nuts, class Std>
+	void adaptor(nb::Bench& bench, const char* name,
+	             u64 n, const std::vector<u64>& keys)
+	{
+		const auto peek = [](auto& box) -> decltype(auto) {
+			if constexpr (requires { box.top(); })
+				return box.top();
+			else
+				return box.front();
+		};
+
+		const auto one = [&]<class Box>(std::string tag) {
+			Box box;
+			for (u64 i = 0; i < n; ++i) box.push(keys[i]);
+
+			bench.run(tag + " push", [&] {
+				Box tmp;
+				for (u64 i = 0; i < n; ++i) tmp.push(keys[i]);
+				nb::doNotOptimizeAway(peek(tmp));
+			});
+			bench.run(tag + " push+pop", [&] {
+				Box tmp;
+				for (u64 i = 0; i < n; ++i) tmp.push(keys[i]);
+				while (!tmp.empty()) tmp.pop();
+				nb::doNotOptimizeAway(tmp.empty());
+			});
+			bench.run(tag + " copy", [&] {
+				Box tmp(box);
+				nb::doNotOptimizeAway(peek(tmp));
+			});
+		};
+
+		bench.title(name);
+		one.template operator()<Nuts>(std::string("nuts::") + name);
+		one.template operator()<Std>(std::string("std::") + name);
+	}
+
+	// set, map, hash_set, hash_map: insert / lookup / erase / iterate / copy
+	template <class Nuts, class Std>
+	void associative(nb::Bench& bench, const char* name,
+	                 u64 n, const std::vector<u64>& keys)
+	{
+		const auto put = []<class Box>(Box& box, u64 k) {
+			if constexpr (Keyed<Box>)
+				box[k] = k;
+			else
+				box.insert(k);
+		};
+
+		const auto sum = []<class Box>(const Box& box) {
+			if constexpr (Keyed<Box>)
+				return key_sum_of(box);
+			else
+				return sum_of(box);
+		};
+
+		const auto one = [&]<class Box>(std::string tag) {
+			Box box;
+			for (u64 i = 0; i < n; ++i) put(box, keys[i]);
+
+			bench.run(tag + " insert", [&] {
+				Box tmp;
+				for (u64 i = 0; i < n; ++i) put(tmp, keys[i]);
+				nb::doNotOptimizeAway(tmp.size());
+			});
+			bench.run(tag + " contains", [&] {
+				u64 res = 0;
+				for (u64 i = n; i-- > 0;) res += box.contains(keys[i]);
+				nb::doNotOptimizeAway(res);
+			});
+			bench.run(tag + " insert+erase", [&] {
+				Box tmp;
+				for (u64 i = 0; i < n; ++i) put(tmp, keys[i]);
+				for (u64 i = 0; i < n; ++i) tmp.erase(keys[i]);
+				nb::doNotOptimizeAway(tmp.size());
+			});
+			bench.run(tag + " iterate", [&] { nb::doNotOptimizeAway(sum(box)); });
+			bench.run(tag + " copy", [&] {
+				Box tmp(box);
+				nb::doNotOptimizeAway(tmp.size());
+			});
+		};
+
+		bench.title(name);
+		one.template operator()<Nuts>(std::string("nuts::") + name);
+		one.template operator()<Std>(std::string("std::") + name);
+	}
+
+	void string(nb::Bench& bench, u64 n, const std::vector<u64>& keys)
+	{
+		// Printable, and never '\0' or the needle '~'
+		const auto ch = [&](u64 i) { return char('a' + keys[i] % 26); };
+
+		const auto one = [&]<class Box>(std::string tag) {
+			// nuts::string::find is strchr and push_back writes no '\0',
+			// so the needle ends the string and is always hit
+			Box box;
+			for (u64 i = 1; i < n; ++i) box.push_back(ch(i));
+			box.push_back('~');
+
+			bench.run(tag + " push_back", [&] {
+				Box tmp;
+				for (u64 i = 0; i < n; ++i) tmp.push_back(ch(i));
+				nb::doNotOptimizeAway(tmp.size());
+			});
+			bench.run(tag + " find(last)", [&] { nb::doNotOptimizeAway(box.find('~')); });
+			bench.run(tag + " push_back+pop_back", [&] {
+				Box tmp;
+				for (u64 i = 0; i < n; ++i) tmp.push_back(ch(i));
+				while (!tmp.empty()) tmp.pop_back();
+				nb::doNotOptimizeAway(tmp.size());
+			});
+			bench.run(tag + " iterate", [&] {
+				u64 res = 0;
+				for (u64 i = 0; i < n; ++i) res += box[i];
+				nb::doNotOptimizeAway(res);
+			});
+			bench.run(tag + " copy", [&] {
+				Box tmp(box);
+				nb::doNotOptimizeAway(tmp.size());
+			});
+		};
+
+		bench.title("basic_string");
+		one.template operator()<nuts::string>("nuts::string");
+		one.template operator()<std::string>("std::string");
+	}
+
+	// Lookups in blocks of 256 keys: a loop over find against one find_many
+	// Every other key is absent, the probe order is shuffled away from insertion
+	template <class Box>
+	void batched(nb::Bench& bench, const char* name, u64 n, const std::vector<u64>& keys)
+	{
+		constexpr u64 B = 256;
+		Box box;
+		for (u64 i = 0; i < n; i += 2) box[keys[i]] = i;
+
+		std::vector<u64> probe(keys.begin(), keys.begin() + n);
+		for (u64 i = n; i > 1; --i) std::swap(probe[i - 1], probe[keys[i - 1] % i]);
+		std::vector<typename Box::iterator> out(B);
+
+		bench.title("batched find");
+		bench.run(std::string("nuts::") + name + " find x" + std::to_string(B), [&] {
+			u64 res = 0;
+			for (u64 st = 0; st < n; st += B)
+				for (u64 i = st; i < std::min(n, st + B); ++i) {
+					auto it = box.find(probe[i]);
+					if (it != Box::npos) res += (*it).second;
+				}
+			nb::doNotOptimizeAway(res);
+		});
+		bench.run(std::string("nuts::") + name + " find_many", [&] {
+			u64 res = 0;
+			for (u64 st = 0; st < n; st += B) {
+				const u64 m = std::min(B, n - st);
+				box.find_many(probe.data() + st, m, out.data());
+				for (u64 i = 0; i < m; ++i)
+					if (out[i] != Box::npos) res += (*out[i]).second;
+			}
+			nb::doNotOptimizeAway(res);
+		});
+	}
+
+	// N is a template argument, so every size is its own instantiation
+	template <u64 N>
+	void bitset(nb::Bench& bench, const std::vector<u64>& keys)
+	{
+		const auto one = [&]<class Box>(std::string tag) {
+			auto box = std::make_unique<Box>();
+			for (u64 i = 0; i < N; i += 3) box->set(i);
+
+			bench.run(tag + " set", [&] {
+				for (u64 i = 0; i < N; ++i) box->set(keys[i] % N);
+				nb::doNotOptimizeAway(box.get());
+			});
+			bench.run(tag + " test", [&] {
+				u64 res = 0;
+				for (u64 i = 0; i < N; ++i) res += box->test(keys[i] % N);
+				nb::doNotOptimizeAway(res);
+			});
+			bench.run(tag + " reset", [&] {
+				for (u64 i = 0; i < N; ++i) box->reset(keys[i] % N);
+				nb::doNotOptimizeAway(box.get());
+			});
+			bench.run(tag + " count", [&] { nb::doNotOptimizeAway(box->count()); });
+			bench.run(tag + " copy", [&] {
+				auto tmp = std::make_unique<Box>(*box);
+				nb::doNotOptimizeAway(tmp.get());
+			});
+		};
+
+		tune(bench, N);
+		bench.title("bitset");
+		one.template operator()<nuts::bitset<N>>("nuts::bitset");
+		one.template operator()<std::bitset<N>>("std::bitset");
+	}
+
+	// No std matrix, compare with a row-major std::array of the same shape
+	template <u64 N>
+	void matrix(nb::Bench& bench, nb::Rng& rng)
+	{
+		using Nuts = nuts::matrix<double, N, N>;
+		using Std = std::array<std::array<double, N>, N>;
+
+		auto a = std::make_unique<Nuts>(), b = std::make_unique<Nuts>();
+		auto x = std::make_unique<Std>(), y = std::make_unique<Std>();
+		for (u64 i = 0; i < N; ++i)
+			for (u64 j = 0; j < N; ++j) {
+				(*x)[i][j] = (*a)[i][j] = rng.uniform01();
+				(*y)[i][j] = (*b)[i][j] = rng.uniform01();
+			}
+
+		tune(bench, N * N);
+		bench.title("matrix");
+
+		bench.run("nuts::matrix operator+", [&] {
+			auto c = std::make_unique<Nuts>(*a + *b);
+			nb::doNotOptimizeAway(c.get());
+		});
+		bench.run("nuts::matrix operator*", [&] {
+			auto c = std::make_unique<Nuts>(*a * *b);
+			nb::doNotOptimizeAway(c.get());
+		});
+		bench.run("nuts::matrix iterate", [&] {
+			double res = 0;
+			for (u64 i = 0; i < N; ++i)
+				for (u64 j = 0; j < N; ++j) res += a->at(i, j);
+			nb::doNotOptimizeAway(res);
+		});
+		bench.run("nuts::matrix copy", [&] {
+			auto c = std::make_unique<Nuts>(*a);
+			nb::doNotOptimizeAway(c.get());
+		});
+
+		bench.run("std::array operator+", [&] {
+			auto c = std::make_unique<Std>();
+			for (u64 i = 0; i < N; ++i)
+				for (u64 j = 0; j < N; ++j) (*c)[i][j] = (*x)[i][j] + (*y)[i][j];
+			nb::doNotOptimizeAway(c.get());
+		});
+		bench.run("std::array operator*", [&] {
+			auto c = std::make_unique<Std>();
+			for (u64 i = 0; i < N; ++i)
+				for (u64 k = 0; k < N; ++k)
+					for (u64 j = 0; j < N; ++j) (*c)[i][j] += (*x)[i][k] * (*y)[k][j];
+			nb::doNotOptimizeAway(c.get());
+		});
+		bench.run("std::array iterate", [&] {
+			double res = 0;
+			for (const auto& row: *x)
+				for (double v: row) res += v;
+			nb::doNotOptimizeAway(res);
+		});
+		bench.run("std::array copy", [&] {
+			auto c = std::make_unique<Std>(*x);
+			nb::doNotOptimizeAway(c.get());
+		});
+	}
+
+	// concurrent_hash_map against one std::mutex around std::unordered_map
+	// Every thread count runs the same n ops in total: 90% find, 10% upsert
+	void concurrent(nb::Bench& bench, u64 n, const std::vector<u64>& keys)
+	{
+		const auto one = [&](std::string tag, auto& find, auto& upsert) {
+			for (u64 t = 1; t <= 64; t *= 2) {
+				bench.batch(n).complexityN(t);
+				bench.run(tag + " x" + std::to_string(t), [&] {
+					std::vector<std::thread> workers;
+					std::atomic<u64> res {0};
+					for (u64 w = 0; w < t; ++w)
+						workers.emplace_back([&, w] {
+							u64 hit = 0;
+							for (u64 i = w; i < n; i += t) {
+								if (i % 10 == 0)
+									upsert(keys[i]);
+								else
+									hit += find(keys[(i * 7) % n]);
+							}
+							res += hit;
+						});
+					for (auto& x: workers) x.join();
+					nb::doNotOptimizeAway(res.load());
+				});
+			}
+		};
+
+		nuts::concurrent_hash_map<u64, u64> nuts_map;
+		for (u64 i = 0; i < n; ++i) nuts_map.insert(keys[i], i);
+		auto nuts_find = [&](u64 k) { return nuts_map.contains(k); };
+		auto nuts_upsert = [&](u64 k) { nuts_map.upsert(k, [](u64& v) { ++v; }); };
+
+		std::unordered_map<u64, u64> std_map;
+		std::mutex mtx;
+		for (u64 i = 0; i < n; ++i) std_map[keys[i]] = i;
+		auto std_find = [&](u64 k) {
+			std::lock_guard lk {mtx};
+			return std_map.count(k) != 0;
+		};
+		auto std_upsert = [&](u64 k) {
+			std::lock_guard lk {mtx};
+			++std_map[k];
+		};
+
+		bench.title("concurrent_hash_map");
+		one("nuts::concurrent_hash_map", nuts_find, nuts_upsert);
+		one("std::unordered_map+mutex", std_find, std_upsert);
+		bench.batch(1);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const u64 max_n = argc > 1 ? std::stoull(argv[1]) : 10000000U;
+	const std::string out = argc > 2 ? argv[2] : "nuts_bench";
+
+	nb::Bench bench;
+	nb::Rng rng;
+	bench.performanceCounters(true);
+
+	for (u64 n = 10; n <= max_n; n *= 10) {
+		const auto keys = make_keys(n, rng);
+		tune(bench, n);
+
+		sequence<nuts::vector<u64>, std::vector<u64>>(bench, "vector", n, keys);
+		sequence<nuts::deque<u64>, std::deque<u64>>(bench, "deque", n, keys);
+		sequence<nuts::list<u64>, std::list<u64>>(bench, "list", n, keys);
+
+		adaptor<nuts::stack<u64>, std::stack<u64>>(bench, "stack", n, keys);
+		adaptor<nuts::queue<u64>, std::queue<u64>>(bench, "queue", n, keys);
+
+		associative<nuts::set<u64>, std::set<u64>>(bench, "set", n, keys);
+		associative<nuts::map<u64, u64>, std::map<u64, u64>>(bench, "map", n, keys);
+		associative<nuts::hash_set<u64>, std::unordered_set<u64>>(bench, "hash_set", n, keys);
+		associative<nuts::hash_map<u64, u64>, std::unordered_map<u64, u64>>(bench, "hash_map", n, keys);
+		associative<nuts::dense_hash_map<u64, u64>, std::unordered_map<u64, u64>>(bench, "dense_hash_map", n, keys);
+
+		string(bench, n, keys);
+
+		batched<nuts::hash_map<u64, u64>>(bench, "hash_map", n, keys);
+		batched<nuts::dense_hash_map<u64, u64>>(bench, "dense_hash_map", n, keys);
+	}
+
+	// Fixed sizes, see the comments above bitset() and matrix()
+	const auto keys = make_keys(max_n, rng);
+	[&]<u64... N>(std::integer_sequence<u64, N...>) {
+		(..., (N <= max_n ? bitset<N>(bench, keys) : void()));
+	}(std::integer_sequence<u64, 10U, 100U, 1000U, 10000U, 100000U, 1000000U, 10000000U> {});
+	matrix<8>(bench, rng);
+	matrix<32>(bench, rng);
+	matrix<128>(bench, rng);
+
+	// Thread scaling, complexityN is the thread count here
+	const u64 cn = max_n < 1000000U ? max_n : 1000000U;
+	tune(bench, cn);
+	concurrent(bench, cn, make_keys(cn, rng));
+
+	std::ofstream json {out + ".json"}, csv {out + ".csv"};
+	nb::render(nb::templates::json(), bench, json);
+	nb::render(nb::templates::csv(), bench, csv);
+	return 0;
+}
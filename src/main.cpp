@@ -42,7 +42,7 @@
 // 	ankerl::nanobench::Rng rng;
 
 // 	nuts::u64 n = 1e5;
-// 	nuts::vector<uint64_t> a;
+// 	nuts::vector<uint64_t> a, c;
 // 	std::vector<uint64_t> b;
 // 	a.reserve(n);
 // 	b.reserve(n);
@@ -51,10 +51,12 @@
 // 		a.emplace_back(rng());
 // 		b.emplace_back(a.back());
 // 	}
+// 	c = a;
 
 // 	bench.relative(true)
 // 	        .minEpochIterations(5)
 // 	        .run("nuts::sort", [&] { nuts::sort(a.begin(), a.end()); })
+// 	        .run("nuts::parallel_sort", [&] { nuts::parallel_sort(c.begin(), c.end()); })
 // 	        .run("std::sort", [&] { std::sort(b.begin(), b.end()); });
 // }
 
@@ -91,7 +93,7 @@ int main()
 
 	std::random_device rng;
 
-	nuts::vector<uint64_t> a;
+	nuts::vector<uint64_t> a, c;
 	std::vector<uint64_t> b;
 
 	a.reserve(n);
@@ -101,6 +103,12 @@ int main()
 		a.emplace_back(rng());
 		b.emplace_back(a.back());
 	}
+	c = a;
+
+	// Alone, so its threads don't compete with the serial sorts
+	Timer clk;
+	nuts::parallel_sort(c);
+	nuts::println("parallel_sort: ", clk.elapsed() * 1000.0, "(ms)");
 
 	nuts::time_cmp(
 	        [&] { nuts::sort(a); },